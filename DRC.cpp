@@ -0,0 +1,100 @@
+#include "drc.hpp"
+#include <fstream>
+#include <unordered_set>
+
+using json = nlohmann::json;
+
+// 对Route_after.json中每种模块检查一次（取第一个实例），给出Layout_after.json时按实例外框检查越界
+int layers = 0;
+int threads = 1;
+long long total_violations = 0;
+
+void checkTree(const json& route_node, const json* layout_node, std::unordered_set<std::string>& seen) {
+    std::string module_name = route_node.value("module_name", "");
+    if (seen.insert(module_name).second) {
+        drc::Layout layout = drc::fromRouteJson(route_node);
+        layout.layers = layers;
+        if (layout_node && layout_node->contains("layout")) {
+            const json& box = (*layout_node)["layout"];
+            layout.x0 = box["x"].get<int>();
+            layout.y0 = box["y"].get<int>();
+            layout.width = box["width"].get<int>();
+            layout.height = box["height"].get<int>();
+        }
+        drc::Report report = drc::check(layout, threads);
+        drc::printReport(module_name, report);
+        total_violations += report.shorts + report.opens + report.off_grid + report.out_of_bounds + report.via_conflicts;
+    }
+    if (!route_node.contains("subModules")) return;
+    for (const auto& [inst, child] : route_node["subModules"].items()) {
+        const json* child_layout = nullptr;
+        if (layout_node && layout_node->contains("subModules") && (*layout_node)["subModules"].contains(inst)) {
+            child_layout = &(*layout_node)["subModules"][inst];
+        }
+        checkTree(child, child_layout, seen);
+    }
+}
+
+void options_helper() {
+    std::cout << "用法：DRC <布线结果> [选项]\n";
+    std::cout << "-l <文件名>   布局结果，用于检查越界 (默认: 不检查边界)\n";
+    std::cout << "-L <层数>     金属层数，用于检查层号越界 (默认: 不检查)\n";
+    std::cout << "-j <线程数>   按层并行检查的线程数 (默认: 1)\n";
+    std::cout << "-h            显示此帮助信息\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        options_helper();
+        return 1;
+    }
+    std::string route_file, layout_file;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-l" && i + 1 < argc) {
+            layout_file = argv[++i];
+        } else if (arg == "-L" && i + 1 < argc) {
+            try {
+                layers = std::stoi(argv[++i]);
+                if (layers < 0) { std::cerr << "错误：层数不能为负数\n"; return 1; }
+            } catch (...) { std::cerr << "错误：无效的-L参数\n"; return 1; }
+        } else if (arg == "-j" && i + 1 < argc) {
+            try {
+                threads = std::stoi(argv[++i]);
+                if (threads <= 0) { std::cerr << "错误：线程数必须为正数\n"; return 1; }
+            } catch (...) { std::cerr << "错误：无效的-j参数\n"; return 1; }
+        } else if (arg == "-h") {
+            options_helper();
+            return 0;
+        } else if (route_file.empty()) {
+            route_file = arg;
+        } else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::ifstream route_in(route_file);
+    if (!route_in.is_open()) {
+        std::cerr << "无法打开文件: " << route_file << std::endl;
+        return 1;
+    }
+    json route_doc = json::parse(route_in);
+    json layout_doc;
+    if (!layout_file.empty()) {
+        std::ifstream layout_in(layout_file);
+        if (!layout_in.is_open()) {
+            std::cerr << "无法打开文件: " << layout_file << std::endl;
+            return 1;
+        }
+        layout_doc = json::parse(layout_in);
+    }
+
+    std::unordered_set<std::string> seen;
+    for (const auto& [top, node] : route_doc.items()) {
+        const json* layout_node = layout_doc.is_object() && layout_doc.contains(top) ? &layout_doc[top] : nullptr;
+        checkTree(node, layout_node, seen);
+    }
+    std::cout << (total_violations == 0 ? "检查通过" : "共" + std::to_string(total_violations) + "处违例") << std::endl;
+    return total_violations == 0 ? 0 : 1;
+}
@@ -8,12 +8,29 @@
 #include <random>
 #include <algorithm>
 #include "json.hpp"
+#include "drc.hpp"
 #include <climits>
 #include <queue>
+#include <deque>
 #include <memory>
 #include <unordered_set>
 #include <functional>
 #include <set>
+#include <filesystem>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ROUTE_SIMD_AVX2 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define ROUTE_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
 
 int MAX_PER_LAYER = 100;          // 每层最大元件数
 int CIRCLE = 1;                   // 循环次数
@@ -24,17 +41,54 @@ const double MIN_TEMP = 1e-5;     // 最小温度 (退火)
 int MAX_LAYER = 3;                // 最大层数
 double MIN_MOS_NUM = 20;          // 最小MOS数量
 double SIZE_WEIGHT = 1000000;     // 面积成本权重
-double IN_MATTER = 1.5;           // input的重要性
-double OUT_MATTER = 0.1;          // output的重要性
 int MAX_METAL_LAYER = 10;         // 最大金属层数
 int VIA_COST = 100;               // 过孔代价
-int LAYER_COST = 10000;           // 层数代价
+double ASTAR_WEIGHT = 1.0;        // A*启发式放大系数（大于1为加权A*，速度快但不保证最短）
+bool BIDIR_ASTAR = false;         // 双向A*搜索
+int GCELL_SIZE = 0;               // 全局布线粗格边长（0为不做全局布线）
+double CONGESTION_WEIGHT = 0.0;   // 退火中拥挤度(RUDY)溢出的成本权重（0为不考虑）
+const int RUDY_BIN = 8;           // 拥挤度统计的格子边长
+const double RUDY_CAPACITY = 1.0; // 每个布线格点可容纳的走线需求
+int REPLACE_RETRIES = 0;          // 布线失败后加宽冲突处元件并重新布局的次数
+const int INFLATE_HALO = 1;       // 重新布局时冲突处元件四周留出的空隙
+const int LEGAL_WINDOW = 64;      // 合法化时的横向搜索窗口
+std::string CACHE_DIR = "";       // 布局布线缓存目录（为空则不使用缓存）
+bool CHECK_ROUTE = false;         // 每个模块布线后做短路/开路/越界/过孔冲突检查
+size_t MEMORY_BUDGET_MB = 0;      // 布线数据常驻内存上限(MB)，超出时把已完成子模块的布线溢出到磁盘（0为不限制）
+std::string SPILL_DIR = "";       // 溢出文件目录，默认为布线结果文件名加.spill
+const int CACHE_VERSION = 1;      // 缓存格式版本
+double ECO_TEMP_RATIO = 0.001;    // ECO局部退火的初始温度（相对INIT_TEMP）
+bool TRACK_JUMP = false;          // 沿优先方向整段滑动扩展（轨道跳跃模式）
+bool ARRAY_PLACE = false;         // 识别阵列/位片，整体作为刚性宏参与退火
+const int ARRAY_MIN_SIZE = 4;     // 阵列至少包含的元件数
+const int ARRAY_CHANNEL = 2;      // 阵列内相邻位片、相邻行之间的间距（格点数），边上的引脚外至少留一条布线轨道
+int MULTILEVEL_LEVELS = 0;        // 多级布局的粗化层数（0为不使用）
+int CLUSTER_MAX = 8;              // 多级布局中一个簇最多包含的原始元件数
+const int CLUSTER_NET_LIMIT = 16; // 粗化时忽略元件数超过此值的线网（如电源）
+const double REFINE_TEMP_RATIO = 1e-6; // 多级布局逐层展开后细化退火的初始温度（相对INIT_TEMP）
+int PARTITION_SIZE = 0;           // 平面模块的MOS数超过此值时按最小割切分为合成子模块（0为不切分）
+const double PARTITION_BALANCE = 0.1; // 切分时一侧元件数允许偏离目标的比例
+const int FM_PASSES = 8;          // FM二分的最多轮数
+int WAVEFRONT_SPAN = 0;           // 两端曼哈顿距离不超过此值的引脚对先用按位波前(Lee)搜索（0为不使用）
+const int WAVE_MARGIN = 16;       // 波前搜索窗口在两端包围盒外留出的格数
+int ROUTE_THREADS = 1;            // 线程数（大于1时按互不相交的包围盒分批并行拆线重布，批量退火也并行评估）
+int SA_KERNEL = 0;                // 退火内核：0为浮点成本，1为定点整数成本（xoshiro随机数，按温度成批生成接受阈值）
+const int64_t COST_FX_ONE = 256;  // 定点成本的1
+int SA_BATCH = 0;                 // 批量退火每批提议的移动数（0为逐个评估）
+long long RANDOM_SEED = -1;       // 随机种子（小于0时每次运行随机）
+int POWER_LAYERS = 0;             // 顶部留给电源/时钟网络的金属层数（0为电源线网按信号线布线）
+const int POWER_DETOUR = 8;       // 电源/时钟轨道绕开障碍时中段最多偏开的格数
+int STEINER_PINS = 4;             // 引脚数不少于此值的线网按斯坦纳树拓扑布线（0为不使用）
+const int STEINER_EXACT_PINS = 8; // 引脚数不超过此值时用迭代1-Steiner求拓扑，更多时用启发式
+const int SIMD_MIN_PINS = 16;     // 引脚数不少于此值的线网用SIMD归约重算包围盒
 
 using json = nlohmann::json;
 using namespace std;
 void print_help();
 struct MosNode;
 struct SubModuleNode;
+struct Net;
+vector<shared_ptr<Net>> loadSpilledNets(const SubModuleNode& module);
 
 // 布线相关结构
 struct PathNode {
@@ -57,18 +111,348 @@ struct Segment {
     int layer;
 };
 
+// 直角斯坦纳最小树(RSMT)的拓扑：nodes的前pin_count个是引脚（与输入顺序一致），
+// 其后是斯坦纳点；edges按布线顺序排列，从0号引脚广度优先，每条边的第一个端点已在树上
+struct SteinerTree {
+    vector<Point> nodes;
+    int pin_count = 0;
+    vector<pair<int, int>> edges;
+
+    static int dist(Point a, Point b) { return abs(a.x - b.x) + abs(a.y - b.y); }
+    int length() const {
+        int len = 0;
+        for (auto [a, b] : edges) len += dist(nodes[a], nodes[b]);
+        return len;
+    }
+};
+
+// 点集的直角最小生成树（Prim，O(n^2)时间、O(n)内存），返回各点的父节点，0号为根
+vector<int> rectilinearMST(const vector<Point>& pts, int* length = nullptr) {
+    int n = pts.size(), total = 0;
+    vector<int> parent(n, -1), dist(n, INT_MAX);
+    vector<char> done(n, 0);
+    if (n > 0) dist[0] = 0;
+    for (int it = 0; it < n; ++it) {
+        int u = -1;
+        for (int v = 0; v < n; ++v) {
+            if (!done[v] && (u < 0 || dist[v] < dist[u])) u = v;
+        }
+        done[u] = 1;
+        total += dist[u];
+        for (int v = 0; v < n; ++v) {
+            if (done[v]) continue;
+            int d = SteinerTree::dist(pts[u], pts[v]);
+            if (d < dist[v]) {
+                dist[v] = d;
+                parent[v] = u;
+            }
+        }
+    }
+    if (length) *length = total;
+    return parent;
+}
+
+// 由邻接表整理出最终的树：与相邻点重合的斯坦纳点并入相邻点，度数不超过2的
+// 斯坦纳点（叶子或拐点）去掉后树长不增，也一并去掉；再广度优先排出边的顺序
+SteinerTree finishSteinerTree(const vector<Point>& nodes, int pin_count, vector<vector<int>> adj) {
+    auto unlink = [&](int a, int b) { adj[a].erase(find(adj[a].begin(), adj[a].end(), b)); };
+    auto link = [&](int a, int b) { adj[a].push_back(b); adj[b].push_back(a); };
+    vector<char> removed(nodes.size(), 0);
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int s = pin_count; s < (int)nodes.size(); ++s) {
+            if (removed[s]) continue;
+            auto same = find_if(adj[s].begin(), adj[s].end(), [&](int v) { return nodes[v] == nodes[s]; });
+            if (same != adj[s].end()) {
+                int keep = *same;
+                for (int v : vector<int>(adj[s])) {
+                    unlink(v, s);
+                    if (v != keep) link(v, keep);
+                }
+            } else if (adj[s].size() == 2) {
+                int a = adj[s][0], b = adj[s][1];
+                unlink(a, s);
+                unlink(b, s);
+                link(a, b);
+            } else if (adj[s].size() == 1) {
+                unlink(adj[s][0], s);
+            } else continue;
+            adj[s].clear();
+            removed[s] = 1;
+            changed = true;
+        }
+    }
+    SteinerTree tree;
+    tree.pin_count = pin_count;
+    vector<int> index(nodes.size(), -1);
+    for (int i = 0; i < (int)nodes.size(); ++i) {
+        if (removed[i]) continue;
+        index[i] = tree.nodes.size();
+        tree.nodes.push_back(nodes[i]);
+    }
+    if (nodes.empty()) return tree;
+    vector<char> seen(nodes.size(), 0);
+    vector<int> queue = { 0 };
+    seen[0] = 1;
+    for (size_t i = 0; i < queue.size(); ++i) {
+        for (int v : adj[queue[i]]) {
+            if (seen[v]) continue;
+            seen[v] = 1;
+            queue.push_back(v);
+            tree.edges.push_back({ index[queue[i]], index[v] });
+        }
+    }
+    return tree;
+}
+
+// 小度数线网：在Hanan网格上反复加入使生成树缩短最多的斯坦纳点（迭代1-Steiner），
+// 每轮去掉已不起作用的斯坦纳点，直到没有点能再缩短
+SteinerTree steinerSmall(const vector<Point>& pins) {
+    int n = pins.size();
+    vector<Point> pts = pins;
+    vector<int> xs, ys;
+    for (const auto& p : pins) {
+        xs.push_back(p.x);
+        ys.push_back(p.y);
+    }
+    sort(xs.begin(), xs.end());
+    xs.erase(unique(xs.begin(), xs.end()), xs.end());
+    sort(ys.begin(), ys.end());
+    ys.erase(unique(ys.begin(), ys.end()), ys.end());
+    int best_len;
+    vector<int> parent = rectilinearMST(pts, &best_len);
+    while (true) {
+        Point best_point = { 0, 0 };
+        int best = best_len;
+        for (int x : xs) {
+            for (int y : ys) {
+                Point c = { x, y };
+                if (find(pts.begin(), pts.end(), c) != pts.end()) continue;
+                pts.push_back(c);
+                int len;
+                rectilinearMST(pts, &len);
+                pts.pop_back();
+                if (len < best) {
+                    best = len;
+                    best_point = c;
+                }
+            }
+        }
+        if (best >= best_len) break;
+        pts.push_back(best_point);
+        parent = rectilinearMST(pts);
+        vector<int> degree(pts.size(), 0);
+        for (int v = 1; v < (int)pts.size(); ++v) {
+            degree[v]++;
+            degree[parent[v]]++;
+        }
+        vector<Point> kept(pts.begin(), pts.begin() + n);
+        for (int s = n; s < (int)pts.size(); ++s) {
+            if (degree[s] > 2) kept.push_back(pts[s]);
+        }
+        pts = move(kept);
+        parent = rectilinearMST(pts, &best_len);
+    }
+    vector<vector<int>> adj(pts.size());
+    for (int v = 1; v < (int)pts.size(); ++v) {
+        adj[v].push_back(parent[v]);
+        adj[parent[v]].push_back(v);
+    }
+    return finishSteinerTree(pts, n, move(adj));
+}
+
+// 大度数线网：先建最小生成树，再逐点把两条相邻边换成经过三点中位点的星形连接
+// （取收益最大的一对），重复几遍直到不再缩短
+SteinerTree steinerLarge(const vector<Point>& pins) {
+    int n = pins.size();
+    vector<Point> nodes = pins;
+    vector<int> parent = rectilinearMST(nodes);
+    vector<vector<int>> adj(n);
+    for (int v = 1; v < n; ++v) {
+        adj[v].push_back(parent[v]);
+        adj[parent[v]].push_back(v);
+    }
+    auto dist = SteinerTree::dist;
+    for (int pass = 0; pass < 4; ++pass) {
+        bool improved = false;
+        for (int u = 0; u < (int)nodes.size(); ++u) {
+            int best_gain = 0, bv = -1, bw = -1;
+            Point best_mid = { 0, 0 };
+            const Point pu = nodes[u];
+            for (size_t i = 0; i < adj[u].size(); ++i) {
+                for (size_t j = i + 1; j < adj[u].size(); ++j) {
+                    const Point pv = nodes[adj[u][i]], pw = nodes[adj[u][j]];
+                    Point mid = {
+                        max(min(pu.x, pv.x), min(max(pu.x, pv.x), pw.x)),
+                        max(min(pu.y, pv.y), min(max(pu.y, pv.y), pw.y))
+                    };
+                    int gain = dist(pu, pv) + dist(pu, pw) - dist(pu, mid) - dist(pv, mid) - dist(pw, mid);
+                    if (gain > best_gain) {
+                        best_gain = gain;
+                        bv = adj[u][i];
+                        bw = adj[u][j];
+                        best_mid = mid;
+                    }
+                }
+            }
+            if (bv < 0) continue;
+            adj[u].erase(find(adj[u].begin(), adj[u].end(), bv));
+            adj[u].erase(find(adj[u].begin(), adj[u].end(), bw));
+            adj[bv].erase(find(adj[bv].begin(), adj[bv].end(), u));
+            adj[bw].erase(find(adj[bw].begin(), adj[bw].end(), u));
+            int s = best_mid == nodes[bv] ? bv : best_mid == nodes[bw] ? bw : -1;
+            if (s < 0) {
+                s = nodes.size();
+                nodes.push_back(best_mid);
+                adj.emplace_back();
+            }
+            for (int v : { u, bv, bw }) {
+                if (v == s) continue;
+                adj[v].push_back(s);
+                adj[s].push_back(v);
+            }
+            improved = true;
+        }
+        if (!improved) break;
+    }
+    return finishSteinerTree(nodes, n, move(adj));
+}
+
+SteinerTree buildSteinerTree(const vector<Point>& pins) {
+    if ((int)pins.size() <= STEINER_EXACT_PINS) return steinerSmall(pins);
+    return steinerLarge(pins);
+}
+
+// 全局布线给线网分配的走廊：以粗格为单位的可走区域
+struct GCellCorridor {
+    int size = 1;           // 粗格边长
+    int gw = 0, gh = 0;     // 粗格数
+    vector<char> mask;      // 可走的粗格
+    vector<int> tree_edges; // 全局布线树的边：2*粗格 + 方向(0向右, 1向上)
+
+    int cellOf(Point p) const { return (p.y / size) * gw + p.x / size; }
+    bool contains(int x, int y) const {
+        return mask[(y / size) * gw + x / size] != 0;
+    }
+    // 粗格及其周围一圈标记为可走
+    void markAround(int cell) {
+        int cx = cell % gw, cy = cell / gw;
+        for (int y = max(cy - 1, 0); y <= min(cy + 1, gh - 1); ++y)
+            for (int x = max(cx - 1, 0); x <= min(cx + 1, gw - 1); ++x) mask[y * gw + x] = 1;
+    }
+    // 树上连接a、b所在粗格的那段路径外扩一圈，作为这一对引脚的搜索范围；
+    // 两点在树上不连通时退回整条线网的走廊
+    GCellCorridor between(Point a, Point b) const {
+        GCellCorridor c = *this;
+        int from = cellOf(a), to = cellOf(b);
+        unordered_map<int, vector<int>> adj;
+        for (int e : tree_edges) {
+            int u = e >> 1, v = u + ((e & 1) ? gw : 1);
+            adj[u].push_back(v);
+            adj[v].push_back(u);
+        }
+        unordered_map<int, int> prev = { { from, from } };
+        vector<int> queue = { from };
+        for (size_t i = 0; i < queue.size() && !prev.count(to); ++i) {
+            for (int v : adj[queue[i]]) {
+                if (prev.emplace(v, queue[i]).second) queue.push_back(v);
+            }
+        }
+        if (!prev.count(to)) return c;
+        c.mask.assign(gw * gh, 0);
+        for (int cell = to; ; cell = prev[cell]) {
+            c.markAround(cell);
+            if (cell == from) break;
+        }
+        return c;
+    }
+};
+
 struct Net {
     string name;
     vector<shared_ptr<Pin>> pins;
     vector<Segment> segments;       // 路径点和层
     vector<Point> vias;             // 过孔
+    bool fixed = false;             // 拆线重布时保持不动
+    shared_ptr<const GCellCorridor> corridor; // 详细布线的搜索范围，为空则不限
+    shared_ptr<const SteinerTree> topology;   // 斯坦纳树拓扑，引脚不变时复用
+};
+
+// 稀疏的按位占用图：按64x64格的瓦片分块，每个瓦片是64个64位字（每行一个字），
+// 全空的瓦片不分配存储，内存随实际占用的区域增长而不是随面积增长
+struct BitGrid {
+    int width = 0, height = 0, words = 0;   // words：每行的64位字数，即横向瓦片数
+    int tiles_y = 0;
+    vector<int> tile_index;                  // 瓦片 -> pool中的起始位置，-1表示全空
+    vector<uint64_t> pool;
+    BitGrid() {}
+    BitGrid(int w, int h) : width(w), height(h), words((w + 63) / 64), tiles_y((h + 63) / 64),
+        tile_index((size_t)words * tiles_y, -1) {}
+
+    // 第y行的第k个字（覆盖x∈[64k, 64k+63]）
+    uint64_t word(int y, int k) const {
+        int t = tile_index[(size_t)(y >> 6) * words + k];
+        return t < 0 ? 0 : pool[t + (y & 63)];
+    }
+    uint64_t& wordRef(int y, int k) {
+        int& t = tile_index[(size_t)(y >> 6) * words + k];
+        if (t < 0) {
+            t = pool.size();
+            pool.resize(pool.size() + 64, 0);
+        }
+        return pool[t + (y & 63)];
+    }
+    bool get(int x, int y) const {
+        return (word(y, x >> 6) >> (x & 63)) & 1;
+    }
+    void set(int x, int y, bool b) {
+        if (b) wordRef(y, x >> 6) |= 1ULL << (x & 63);
+        else if (word(y, x >> 6)) wordRef(y, x >> 6) &= ~(1ULL << (x & 63));
+    }
+    void orWord(int y, int k, uint64_t v) {
+        if (k == words - 1 && (width & 63)) v &= (1ULL << (width & 63)) - 1;
+        if (v) wordRef(y, k) |= v;
+    }
+    size_t memoryBytes() const {
+        return tile_index.size() * sizeof(int) + pool.size() * sizeof(uint64_t);
+    }
+
+    // 把src平移(ox, oy)后按字或入本图，超出边界的部分裁掉
+    void orShifted(const BitGrid& src, int ox, int oy) {
+        if (ox < 0) {
+            for (int y = 0; y < src.height; ++y) {
+                for (int x = 0; x < src.width; ++x) {
+                    int tx = x + ox, ty = y + oy;
+                    if (tx >= 0 && tx < width && ty >= 0 && ty < height && src.get(x, y)) set(tx, ty, true);
+                }
+            }
+            return;
+        }
+        int wo = ox >> 6, sh = ox & 63;
+        // 只遍历src中非空的瓦片
+        for (int ty = 0; ty < src.tiles_y; ++ty) {
+            for (int tx = 0; tx < src.words; ++tx) {
+                int t = src.tile_index[(size_t)ty * src.words + tx];
+                if (t < 0) continue;
+                int k = wo + tx;
+                if (k >= words) continue;
+                for (int r = 0; r < 64; ++r) {
+                    int y = ty * 64 + r;
+                    uint64_t v = src.pool[t + r];
+                    if (!v || y >= src.height || y + oy < 0 || y + oy >= height) continue;
+                    orWord(y + oy, k, v << sh);
+                    if (sh && k + 1 < words) orWord(y + oy, k + 1, v >> (64 - sh));
+                }
+            }
+        }
+    }
 };
 
 // 金属层管理
 struct MetalLayer {
     int layer_id;
     bool is_horizontal;     // 是否是水平方向
-    vector<vector<bool>> used;
+    BitGrid used;
 };
 
 class RoutingGrid {
@@ -76,33 +460,46 @@ private:
 
 public:
     vector<MetalLayer> metal_layers;
-    vector<vector<bool>> via_space;
+    BitGrid via_space;
     int width, height;
+    int signal_layers = 0; // 信号线可用的层数，其上各层留给电源网络
     RoutingGrid() : width(0), height(0) {}
-    RoutingGrid(int w, int h, int num_layers) : width(min(w,int(0.91*w+1))), height(min(h,int(0.92*h+1))) {
+    RoutingGrid(int w, int h, int num_layers) : width(min(w,int(0.91*w+1))), height(min(h,int(0.92*h+1))),
+        signal_layers(num_layers - POWER_LAYERS) {
         metal_layers.resize(num_layers);
         for (int i = 0; i < num_layers; ++i) {
             metal_layers[i].layer_id = i;
             metal_layers[i].is_horizontal = (i % 2 == 0);
-            metal_layers[i].used.resize(height, vector<bool>(width, false));
+            metal_layers[i].used = BitGrid(width, height);
         }
-        via_space.resize(height, vector<bool>(width, false));
+        via_space = BitGrid(width, height);
+    }
+
+    bool inBounds(Point p) const {
+        return p.x >= 0 && p.x < width && p.y >= 0 && p.y < height;
     }
 
     bool isPositionFree(int layer, Point p) const {
-        return !metal_layers[layer].used[p.y][p.x];
+        return !metal_layers[layer].used.get(p.x, p.y);
     }
 
     bool isViaFree(Point p) const {
-        return via_space[p.y][p.x] == false;
+        return !via_space.get(p.x, p.y);
     }
 
+    // 越界的点直接忽略
     void setUsed(int layer, Point p, bool status) {
-        metal_layers[layer].used[p.y][p.x] = status;
+        if (inBounds(p)) metal_layers[layer].used.set(p.x, p.y, status);
     }
 
     void setViaOccupied(Point p, bool b) {
-        via_space[p.y][p.x] = b;
+        if (inBounds(p)) via_space.set(p.x, p.y, b);
+    }
+
+    size_t memoryBytes() const {
+        size_t bytes = via_space.memoryBytes();
+        for (const auto& layer : metal_layers) bytes += layer.used.memoryBytes();
+        return bytes;
     }
 };
 
@@ -120,6 +517,7 @@ struct Component {
     shared_ptr<MosNode> pMosNode;
     vector<string> in;
     vector<string> out;
+    bool fixed = false;  // 退火时保持不动
     tuple<int, int, int, int> bbox() const {
         return make_tuple(x, y, x + width, y + height);
     }
@@ -152,6 +550,16 @@ struct SubModuleNode
     vector<shared_ptr<Net>> nets;
     bool isvcc = false;
     bool isgnd = false;
+    string content_hash;            // 网表子树及参数的哈希，用作缓存键
+    int route_overflow = 0;         // 全局布线的拥挤溢出
+    shared_ptr<const vector<BitGrid>> occupancy_tile; // 布线完成后的各层占用
+    string spill_path;              // 布线已溢出到磁盘时的文件，为空表示nets常驻内存
+    // ECO增量模式：保留的核心元件（非端口、非线）中的一个锚点及其在前次结果中的坐标，用于平移前次布线。
+    // 端口由arrangePorts重新排列，不随核心平移，不能做锚点
+    bool eco = false;
+    shared_ptr<Component> eco_anchor;
+    Point eco_anchor_pos = { 0, 0 };
+    unordered_set<string> eco_kept;  // 保留前次位置的核心元件名
 };
 struct MosNode
 {
@@ -167,29 +575,48 @@ unordered_map<string, pair<int, int>> component_sizes = {
     {"nmos", {6, 4}},
     {"pmos", {6, 4}},
 };
+// 各端口类型所在线网的线长权重
+unordered_map<string, double> net_weights = {
+    {"input", 1.5},
+    {"output", 0.1},
+    {"power", 1.5},
+    {"wire", 1.0},
+};
 unordered_map<string, shared_ptr<SubModuleNode>> Layouted_map;
+// 布线失败的模块类型，以及重新布局时需要加宽的元件（模块类型 -> 元件名）
+unordered_set<string> failed_modules;
+unordered_map<string, unordered_set<string>> inflated_cells;
+unordered_set<string> replaced_modules; // 需要重新布局的模块类型，不再读缓存
 // 全局缓存，避免重复构建相同模块
 unordered_map<string, shared_ptr<SubModuleNode>> module_cache;
 
+// 引脚接入点在引脚层和过孔层上始终保留给所属线网，拆线时也不释放
+void reservePinCells(const Net& net, RoutingGrid& grid) {
+    for (const auto& pin : net.pins) {
+        grid.setUsed(pin->layer, pin->pos, true);
+        grid.setViaOccupied(pin->pos, true);
+    }
+}
+
 void markNetOnGrid(Net& net, RoutingGrid& grid) {
     for (const auto& seg : net.segments) {
         if (seg.start.x == seg.end.x) { // 垂直线
             int y_min = min(seg.start.y, seg.end.y);
             int y_max = max(seg.start.y, seg.end.y);
             for (int y = y_min; y <= y_max; y++) {
-                grid.metal_layers[seg.layer].used[y][seg.start.x] = true;
+                grid.setUsed(seg.layer, { seg.start.x, y }, true);
             }
         }
         else { // 水平线
             int x_min = min(seg.start.x, seg.end.x);
             int x_max = max(seg.start.x, seg.end.x);
             for (int x = x_min; x <= x_max; x++) {
-                grid.metal_layers[seg.layer].used[seg.start.y][x] = true;
+                grid.setUsed(seg.layer, { x, seg.start.y }, true);
             }
         }
     }
     for (const auto& via : net.vias) {
-        grid.via_space[via.y][via.x] = true; // 标记过孔已被占用
+        grid.setViaOccupied(via, true); // 标记过孔已被占用
     }
 }
 
@@ -199,116 +626,797 @@ void unmarkNetOnGrid(Net& net, RoutingGrid& grid) {
             int y_min = min(seg.start.y, seg.end.y);
             int y_max = max(seg.start.y, seg.end.y);
             for (int y = y_min; y <= y_max; y++) {
-                grid.metal_layers[seg.layer].used[y][seg.start.x] = false;
+                grid.setUsed(seg.layer, { seg.start.x, y }, false);
             }
         }
         else { // 水平线
             int x_min = min(seg.start.x, seg.end.x);
             int x_max = max(seg.start.x, seg.end.x);
             for (int x = x_min; x <= x_max; x++) {
-                grid.metal_layers[seg.layer].used[seg.start.y][x] = false;
+                grid.setUsed(seg.layer, { x, seg.start.y }, false);
             }
         }
     }
     for (const auto& via : net.vias) {
-        grid.via_space[via.y][via.x] = false;
+        grid.setViaOccupied(via, false);
     }
+    reservePinCells(net, grid);
 }
 
 
 
-//计算两个元件之间的距离（a的output端口的位置到b的input端口的位置）
-double distance(const Component& a, const Component& b) {
-    /*
-    double ax = a.x, ay = a.y;
-    if (a.type == "pmos" || a.type == "nmos") {
-        ax += a.width;
-        ay += a.height / 2.0;
+// 连续int数组上的归约内核：最小值、最大值、等于v的个数。x86上运行时检测AVX2，
+// ARM上用NEON，其余退回标量；退火中包围盒和线网半周长都由它们计算
+namespace simd {
+
+int minScalar(const int* a, int n) {
+    int r = INT_MAX;
+    for (int i = 0; i < n; ++i) r = min(r, a[i]);
+    return r;
+}
+int maxScalar(const int* a, int n) {
+    int r = INT_MIN;
+    for (int i = 0; i < n; ++i) r = max(r, a[i]);
+    return r;
+}
+int countScalar(const int* a, int n, int v) {
+    int r = 0;
+    for (int i = 0; i < n; ++i) r += a[i] == v;
+    return r;
+}
+// 是否有矩形与查询矩形q（左、下、右、上、层）在同层相交
+bool overlapScalar(const int* l, const int* b, const int* r, const int* t, const int* layer, int n, const int* q) {
+    for (int i = 0; i < n; ++i) {
+        if (layer[i] == q[4] && l[i] < q[2] && r[i] > q[0] && b[i] < q[3] && t[i] > q[1]) return true;
+    }
+    return false;
+}
+
+#if ROUTE_SIMD_AVX2
+__attribute__((target("avx2"))) int minAvx2(const int* a, int n) {
+    int i = 0, r = INT_MAX;
+    if (n >= 8) {
+        __m256i m = _mm256_loadu_si256((const __m256i*)a);
+        for (i = 8; i + 8 <= n; i += 8) m = _mm256_min_epi32(m, _mm256_loadu_si256((const __m256i*)(a + i)));
+        __m128i h = _mm_min_epi32(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+        h = _mm_min_epi32(h, _mm_shuffle_epi32(h, 0x4E));
+        h = _mm_min_epi32(h, _mm_shuffle_epi32(h, 0xB1));
+        r = _mm_cvtsi128_si32(h);
     }
-    else if (a.type == "input" || a.type == "output" || a.type == "power" || a.type == "wire") {
-        ax += a.width;
-        ay += a.height / 2.0;
+    for (; i < n; ++i) r = min(r, a[i]);
+    return r;
+}
+__attribute__((target("avx2"))) int maxAvx2(const int* a, int n) {
+    int i = 0, r = INT_MIN;
+    if (n >= 8) {
+        __m256i m = _mm256_loadu_si256((const __m256i*)a);
+        for (i = 8; i + 8 <= n; i += 8) m = _mm256_max_epi32(m, _mm256_loadu_si256((const __m256i*)(a + i)));
+        __m128i h = _mm_max_epi32(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+        h = _mm_max_epi32(h, _mm_shuffle_epi32(h, 0x4E));
+        h = _mm_max_epi32(h, _mm_shuffle_epi32(h, 0xB1));
+        r = _mm_cvtsi128_si32(h);
     }
-    else {
-        ax += a.width;
+    for (; i < n; ++i) r = max(r, a[i]);
+    return r;
+}
+__attribute__((target("avx2,popcnt"))) int countAvx2(const int* a, int n, int v) {
+    int i = 0, r = 0;
+    __m256i key = _mm256_set1_epi32(v);
+    for (; i + 8 <= n; i += 8) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(a + i)), key);
+        r += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(eq)));
+    }
+    for (; i < n; ++i) r += a[i] == v;
+    return r;
+}
+__attribute__((target("avx2"))) bool overlapAvx2(const int* l, const int* b, const int* r, const int* t, const int* layer, int n, const int* q) {
+    int i = 0;
+    __m256i ql = _mm256_set1_epi32(q[0]), qb = _mm256_set1_epi32(q[1]);
+    __m256i qr = _mm256_set1_epi32(q[2]), qt = _mm256_set1_epi32(q[3]), qz = _mm256_set1_epi32(q[4]);
+    for (; i + 8 <= n; i += 8) {
+        __m256i hit = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(layer + i)), qz);
+        hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(qr, _mm256_loadu_si256((const __m256i*)(l + i))));
+        hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)(r + i)), ql));
+        hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(qt, _mm256_loadu_si256((const __m256i*)(b + i))));
+        hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)(t + i)), qb));
+        if (!_mm256_testz_si256(hit, hit)) return true;
+    }
+    return overlapScalar(l + i, b + i, r + i, t + i, layer + i, n - i, q);
+}
+#endif
+
+#if ROUTE_SIMD_NEON
+int minNeon(const int* a, int n) {
+    int i = 0, r = INT_MAX;
+    if (n >= 4) {
+        int32x4_t m = vld1q_s32(a);
+        for (i = 4; i + 4 <= n; i += 4) m = vminq_s32(m, vld1q_s32(a + i));
+        r = vminvq_s32(m);
     }
-    double bx = b.x, by = b.y;
-    if (b.type == "nmos" || b.type == "pmos") {
-        if (b.pMosNode->source == a.name) {
-            by += b.height / 2.0;
+    for (; i < n; ++i) r = min(r, a[i]);
+    return r;
+}
+int maxNeon(const int* a, int n) {
+    int i = 0, r = INT_MIN;
+    if (n >= 4) {
+        int32x4_t m = vld1q_s32(a);
+        for (i = 4; i + 4 <= n; i += 4) m = vmaxq_s32(m, vld1q_s32(a + i));
+        r = vmaxvq_s32(m);
+    }
+    for (; i < n; ++i) r = max(r, a[i]);
+    return r;
+}
+int countNeon(const int* a, int n, int v) {
+    int i = 0, r = 0;
+    int32x4_t key = vdupq_n_s32(v), acc = vdupq_n_s32(0);
+    // 相等的lane为全1即-1，累减得到个数
+    for (; i + 4 <= n; i += 4) acc = vsubq_s32(acc, vreinterpretq_s32_u32(vceqq_s32(vld1q_s32(a + i), key)));
+    r = vaddvq_s32(acc);
+    for (; i < n; ++i) r += a[i] == v;
+    return r;
+}
+bool overlapNeon(const int* l, const int* b, const int* r, const int* t, const int* layer, int n, const int* q) {
+    int i = 0;
+    int32x4_t ql = vdupq_n_s32(q[0]), qb = vdupq_n_s32(q[1]);
+    int32x4_t qr = vdupq_n_s32(q[2]), qt = vdupq_n_s32(q[3]), qz = vdupq_n_s32(q[4]);
+    for (; i + 4 <= n; i += 4) {
+        uint32x4_t hit = vceqq_s32(vld1q_s32(layer + i), qz);
+        hit = vandq_u32(hit, vcltq_s32(vld1q_s32(l + i), qr));
+        hit = vandq_u32(hit, vcgtq_s32(vld1q_s32(r + i), ql));
+        hit = vandq_u32(hit, vcltq_s32(vld1q_s32(b + i), qt));
+        hit = vandq_u32(hit, vcgtq_s32(vld1q_s32(t + i), qb));
+        if (vmaxvq_u32(hit)) return true;
+    }
+    return overlapScalar(l + i, b + i, r + i, t + i, layer + i, n - i, q);
+}
+#endif
+
+struct Kernels {
+    int (*min)(const int*, int);
+    int (*max)(const int*, int);
+    int (*count)(const int*, int, int);
+    bool (*overlap)(const int*, const int*, const int*, const int*, const int*, int, const int*);
+    const char* name;
+};
+
+const Kernels& kernels() {
+    static const Kernels k = [] {
+#if ROUTE_SIMD_AVX2
+        if (__builtin_cpu_supports("avx2")) return Kernels{ minAvx2, maxAvx2, countAvx2, overlapAvx2, "avx2" };
+#elif ROUTE_SIMD_NEON
+        return Kernels{ minNeon, maxNeon, countNeon, overlapNeon, "neon" };
+#endif
+        return Kernels{ minScalar, maxScalar, countScalar, overlapScalar, "scalar" };
+    }();
+    return k;
+}
+
+} // namespace simd
+
+// 核心元件（不含端口和线）的包围盒，坐标按列分开存放（左、下、右、上各一个数组）
+// 供SIMD归约；slot把元件下标映射到数组位置，端口为-1
+struct CoreBBox {
+    vector<int> left, bottom, right, top;
+    vector<int> slot;
+
+    void build(const vector<shared_ptr<Component>>& components) {
+        left.clear(); bottom.clear(); right.clear(); top.clear();
+        slot.assign(components.size(), -1);
+        for (int i = 0; i < (int)components.size(); ++i) {
+            const auto& c = *components[i];
+            if (c.type == "input" || c.type == "output" || c.type == "power" || c.type == "wire") continue;
+            slot[i] = left.size();
+            left.push_back(c.x);
+            bottom.push_back(c.y);
+            right.push_back(c.x + c.width);
+            top.push_back(c.y + c.height);
+        }
+    }
+
+    bool core(int comp) const { return slot[comp] >= 0; }
+
+    void set(int comp, int x, int y) {
+        int s = slot[comp];
+        if (s < 0) return;
+        right[s] += x - left[s];
+        top[s] += y - bottom[s];
+        left[s] = x;
+        bottom[s] = y;
+    }
+
+    // 包围盒面积；moved不为-1时该元件取(x, y)。只读，可并行调用
+    long long areaWith(int moved, int x, int y) const {
+        const auto& k = simd::kernels();
+        int n = left.size(), s = moved >= 0 ? slot[moved] : -1;
+        int lo_x = INT_MAX, lo_y = INT_MAX, hi_x = INT_MIN, hi_y = INT_MIN;
+        // 跳过被移动的元件：分[0, s)和(s, n)两段归约
+        int ranges[2][2] = { { 0, s < 0 ? n : s }, { s < 0 ? n : s + 1, n } };
+        for (auto& r : ranges) {
+            int len = r[1] - r[0];
+            if (len <= 0) continue;
+            lo_x = min(lo_x, k.min(left.data() + r[0], len));
+            lo_y = min(lo_y, k.min(bottom.data() + r[0], len));
+            hi_x = max(hi_x, k.max(right.data() + r[0], len));
+            hi_y = max(hi_y, k.max(top.data() + r[0], len));
         }
-        else if (b.pMosNode->drain == a.name) {
-            by += b.height;
-            bx += b.width / 2.0;
+        if (s >= 0) {
+            lo_x = min(lo_x, x);
+            lo_y = min(lo_y, y);
+            hi_x = max(hi_x, x + right[s] - left[s]);
+            hi_y = max(hi_y, y + top[s] - bottom[s]);
         }
+        return lo_x > hi_x ? 0 : (long long)(hi_x - lo_x) * (hi_y - lo_y);
     }
-    else if (a.type == "input" || a.type == "output" || a.type == "power" || a.type == "wire") {
-        ay += a.height / 2.0;
+
+    long long area() const { return areaWith(-1, 0, 0); }
+};
+
+// 元件矩形按列存放，供退火的重叠检查做SIMD扫描。输出端口不参与重叠检查；
+// 线只在交换时检查，单独成组
+struct CompRects {
+    struct Group {
+        vector<int> left, bottom, right, top, layer;
+    };
+    Group solid, wires;
+    vector<pair<int, int>> slot; // 元件 -> (组：0为solid、1为wires、-1为不参与, 组内位置)
+    vector<int> width, height;
+
+    void build(const vector<shared_ptr<Component>>& components) {
+        solid = Group();
+        wires = Group();
+        slot.assign(components.size(), { -1, -1 });
+        width.resize(components.size());
+        height.resize(components.size());
+        for (int i = 0; i < (int)components.size(); ++i) {
+            const auto& c = *components[i];
+            width[i] = c.width;
+            height[i] = c.height;
+            if (c.type == "output") continue;
+            int g = c.type == "wire" ? 1 : 0;
+            Group& group = g ? wires : solid;
+            slot[i] = { g, (int)group.left.size() };
+            group.left.push_back(c.x);
+            group.bottom.push_back(c.y);
+            group.right.push_back(c.x + c.width);
+            group.top.push_back(c.y + c.height);
+            group.layer.push_back(c.layer);
+        }
     }
-    return sqrt(pow(ax - bx, 2) + pow(ay - by, 2)); // 使用欧几里得距离
-    */
-    if (a.type == "wire" || b.type == "wire") {
-        cout << "试图计算" + a.type + "类型的" + a.name + "到" + b.type + "类型的" + b.name + "之间的距离" << endl;
-        return -1;
+
+    void set(int comp, int x, int y, int layer) {
+        auto [g, s] = slot[comp];
+        if (g < 0) return;
+        Group& group = g ? wires : solid;
+        group.left[s] = x;
+        group.bottom[s] = y;
+        group.right[s] = x + width[comp];
+        group.top[s] = y + height[comp];
+        group.layer[s] = layer;
     }
-    else return sqrt(pow(a.x - b.x, 2) + pow(a.y - b.y, 2));
-}
 
-// 计算退火中的元件线长成本
-double calculate_component_cost(double p, shared_ptr<Component> comp,
-    const unordered_map<string, vector<shared_ptr<Component>>>& in_map,
-    const unordered_map<string, vector<shared_ptr<Component>>>& out_map) {
-    double cost = 0.0;
-    if (in_map.count(comp->name)) for (const auto& net : in_map.at(comp->name)) {
-        if (net->type == "input" || net->type == "power") cost += IN_MATTER * distance(*net, *comp);
-        else if (in_map.count(net->name)) for (const auto& one : in_map.at(net->name)) {
-            cost += distance(*one, *comp);
+    // 元件comp放在(x, y, layer)时是否与其他元件重叠（跳过comp自身和skip）
+    bool overlaps(int comp, int x, int y, int layer, bool with_wires, int skip = -1) const {
+        const auto& k = simd::kernels();
+        int q[5] = { x, y, x + width[comp], y + height[comp], layer };
+        for (int g = 0; g < (with_wires ? 2 : 1); ++g) {
+            const Group& group = g ? wires : solid;
+            int n = group.left.size(), s = slot[comp].first == g ? slot[comp].second : n;
+            int t = skip >= 0 && slot[skip].first == g ? slot[skip].second : n;
+            if (s > t) swap(s, t);
+            for (auto [lo, hi] : { pair<int, int>{ 0, s }, pair<int, int>{ s + 1, t }, pair<int, int>{ t + 1, n } }) {
+                if (hi > lo && k.overlap(group.left.data() + lo, group.bottom.data() + lo, group.right.data() + lo,
+                    group.top.data() + lo, group.layer.data() + lo, hi - lo, q)) return true;
+            }
         }
-        else {
-            cout << net->name << endl;
+        return false;
+    }
+};
+
+// 线网上的一个引脚：所属元件下标及相对元件左下角的偏移
+struct PinRef {
+    int comp;
+    int dx, dy;
+};
+
+// 线网包围盒，同时记录落在各边界上的引脚数，用于增量更新
+struct NetBox {
+    int min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+    int n_min_x = 0, n_max_x = 0, n_min_y = 0, n_max_y = 0;
+    int hpwl() const { return (max_x - min_x) + (max_y - min_y); }
+};
+
+// 布局线网
+struct PlaceNet {
+    string name;
+    double weight = 1.0;
+    int64_t weight_fx = COST_FX_ONE; // 定点权重
+    vector<PinRef> pins;
+    int first = 0;                   // 引脚在NetModel::pin_x/pin_y中的起始位置
+    NetBox box;
+};
+
+// 一次元件移动：元件下标及新坐标
+struct CompMove {
+    int comp;
+    int new_x, new_y;
+};
+
+// 增量评估时的临时包围盒（只在接受移动时写回）
+struct NetModelScratch {
+    vector<int> touched;          // 本次评估涉及的线网
+    vector<NetBox> boxes;         // 与touched一一对应
+    vector<bool> stale;           // 包围盒是否需要重算
+    vector<int> slot;             // 线网 -> 在touched中的位置，-1表示未涉及
+    vector<double> bin_delta;     // 拥挤格子的需求变化
+    vector<char> bin_seen;        // 格子是否已在bins中
+    vector<int> bins;             // 本次评估涉及的格子
+};
+
+// 以线网为中心的线长模型：每个线网的半周长线长(HPWL)乘以端口类型权重
+class NetModel {
+public:
+    vector<PlaceNet> nets;
+    vector<vector<pair<int, int>>> comp_pins;  // 元件 -> (线网下标, 引脚下标)
+    vector<int> pos_x, pos_y;                  // 元件坐标，与components同步
+    vector<int> pin_x, pin_y;                  // 所有线网的引脚坐标，按线网连续存放
+
+    void build(const vector<shared_ptr<Component>>& components,
+        const unordered_map<string, vector<shared_ptr<Component>>>& in_map,
+        const unordered_map<string, vector<shared_ptr<Component>>>& out_map) {
+        nets.clear();
+        comp_pins.assign(components.size(), {});
+        pos_x.resize(components.size());
+        pos_y.resize(components.size());
+        unordered_map<const Component*, int> index;
+        unordered_map<string, int> name_index;
+        for (int i = 0; i < (int)components.size(); ++i) {
+            index[components[i].get()] = i;
+            name_index[components[i]->name] = i;
+            pos_x[i] = components[i]->x;
+            pos_y[i] = components[i]->y;
+        }
+        for (int i = 0; i < (int)components.size(); ++i) {
+            const auto& port = components[i];
+            if (port->type != "input" && port->type != "output"
+                && port->type != "power" && port->type != "wire") continue;
+            PlaceNet net;
+            net.name = port->name;
+            auto w = net_weights.find(port->type);
+            if (w != net_weights.end()) net.weight = w->second;
+            net.weight_fx = llround(net.weight * COST_FX_ONE);
+            vector<int> members;
+            if (port->type != "wire") members.push_back(i);
+            for (auto* m : { &in_map, &out_map }) {
+                auto it = m->find(port->name);
+                if (it == m->end()) continue;
+                for (const auto& c : it->second) members.push_back(index.at(c.get()));
+            }
+            // 端口自身的连接表（可能是"实例名.端口名"）
+            for (auto* names : { &port->in, &port->out }) {
+                for (const auto& n : *names) {
+                    auto it = name_index.find(n.substr(0, n.find('.')));
+                    if (it != name_index.end()) members.push_back(it->second);
+                }
+            }
+            sort(members.begin(), members.end());
+            members.erase(unique(members.begin(), members.end()), members.end());
+            for (int m : members) {
+                const auto& c = components[m];
+                if (c->type == "wire") continue;
+                net.pins.push_back({ m, c->width / 2, c->height / 2 });
+            }
+            if (net.pins.size() < 2) continue;
+            int id = nets.size();
+            for (int k = 0; k < (int)net.pins.size(); ++k) {
+                comp_pins[net.pins[k].comp].push_back({ id, k });
+            }
+            nets.push_back(move(net));
+        }
+        pin_x.clear();
+        pin_y.clear();
+        for (auto& net : nets) {
+            net.first = pin_x.size();
+            for (const auto& pin : net.pins) {
+                pin_x.push_back(pos_x[pin.comp] + pin.dx);
+                pin_y.push_back(pos_y[pin.comp] + pin.dy);
+            }
+        }
+        for (int id = 0; id < (int)nets.size(); ++id) {
+            nets[id].box = computeBox(nets[id], nullptr, 0);
         }
     }
-    if (out_map.count(comp->name)) for (const auto& net : out_map.at(comp->name)) {
-        if (net->type == "output" || net->type == "power") cost += OUT_MATTER * distance(*net, *comp);
-        else if (out_map.count(net->name)) for (const auto& tar : out_map.at(net->name)) {
-            cost += distance(*comp, *tar);
+
+    // 从头计算线网包围盒，moves中的元件取其新坐标
+    NetBox computeBox(const PlaceNet& net, const CompMove* moves, int k) const {
+        if ((int)net.pins.size() >= SIMD_MIN_PINS) return reduceBox(net, moves, k);
+        NetBox b;
+        b.min_x = b.min_y = INT_MAX;
+        b.max_x = b.max_y = INT_MIN;
+        for (const auto& pin : net.pins) {
+            int x = pos_x[pin.comp], y = pos_y[pin.comp];
+            for (int m = 0; m < k; ++m) {
+                if (moves[m].comp == pin.comp) { x = moves[m].new_x; y = moves[m].new_y; }
+            }
+            x += pin.dx;
+            y += pin.dy;
+            if (x < b.min_x) { b.min_x = x; b.n_min_x = 1; } else if (x == b.min_x) b.n_min_x++;
+            if (x > b.max_x) { b.max_x = x; b.n_max_x = 1; } else if (x == b.max_x) b.n_max_x++;
+            if (y < b.min_y) { b.min_y = y; b.n_min_y = 1; } else if (y == b.min_y) b.n_min_y++;
+            if (y > b.max_y) { b.max_y = y; b.n_max_y = 1; } else if (y == b.max_y) b.n_max_y++;
         }
-        else {
-            cout << net->name << endl;
+        return b;
+    }
+
+    // 大线网在连续的引脚坐标上做SIMD归约；被移动元件的引脚不在数组中归约，单独并入
+    NetBox reduceBox(const PlaceNet& net, const CompMove* moves, int k) const {
+        const auto& simd_k = simd::kernels();
+        int id = &net - nets.data();
+        int skip[2], moved_x[2], moved_y[2], ns = 0;
+        for (int m = 0; m < k; ++m) {
+            for (const auto& [net_id, pin_idx] : comp_pins[moves[m].comp]) {
+                if (net_id != id) continue;
+                skip[ns] = net.first + pin_idx;
+                moved_x[ns] = moves[m].new_x + net.pins[pin_idx].dx;
+                moved_y[ns] = moves[m].new_y + net.pins[pin_idx].dy;
+                ns++;
+            }
+        }
+        if (ns == 2 && skip[0] > skip[1]) swap(skip[0], skip[1]);
+        // 剔除skip后剩下的至多三段
+        int ranges[3][2], nr = 0, lo = net.first;
+        for (int i = 0; i < ns; ++i) {
+            ranges[nr][0] = lo; ranges[nr][1] = skip[i]; nr++;
+            lo = skip[i] + 1;
+        }
+        ranges[nr][0] = lo; ranges[nr][1] = net.first + (int)net.pins.size(); nr++;
+
+        NetBox b;
+        b.min_x = b.min_y = INT_MAX;
+        b.max_x = b.max_y = INT_MIN;
+        for (int r = 0; r < nr; ++r) {
+            int len = ranges[r][1] - ranges[r][0];
+            if (len <= 0) continue;
+            const int* xs = pin_x.data() + ranges[r][0];
+            const int* ys = pin_y.data() + ranges[r][0];
+            b.min_x = min(b.min_x, simd_k.min(xs, len));
+            b.max_x = max(b.max_x, simd_k.max(xs, len));
+            b.min_y = min(b.min_y, simd_k.min(ys, len));
+            b.max_y = max(b.max_y, simd_k.max(ys, len));
+        }
+        for (int i = 0; i < ns; ++i) {
+            b.min_x = min(b.min_x, moved_x[i]);
+            b.max_x = max(b.max_x, moved_x[i]);
+            b.min_y = min(b.min_y, moved_y[i]);
+            b.max_y = max(b.max_y, moved_y[i]);
+        }
+        for (int r = 0; r < nr; ++r) {
+            int len = ranges[r][1] - ranges[r][0];
+            if (len <= 0) continue;
+            const int* xs = pin_x.data() + ranges[r][0];
+            const int* ys = pin_y.data() + ranges[r][0];
+            b.n_min_x += simd_k.count(xs, len, b.min_x);
+            b.n_max_x += simd_k.count(xs, len, b.max_x);
+            b.n_min_y += simd_k.count(ys, len, b.min_y);
+            b.n_max_y += simd_k.count(ys, len, b.max_y);
+        }
+        for (int i = 0; i < ns; ++i) {
+            b.n_min_x += moved_x[i] == b.min_x;
+            b.n_max_x += moved_x[i] == b.max_x;
+            b.n_min_y += moved_y[i] == b.min_y;
+            b.n_max_y += moved_y[i] == b.max_y;
+        }
+        return b;
+    }
+
+    // 按当前坐标估计的总线长：不少于STEINER_PINS个引脚的线网取斯坦纳树长度，其余取半周长
+    long long steinerLength() const {
+        long long total = 0;
+        for (const auto& net : nets) {
+            if (STEINER_PINS == 0 || (int)net.pins.size() < STEINER_PINS) {
+                total += net.box.hpwl();
+                continue;
+            }
+            vector<Point> points;
+            for (const auto& pin : net.pins) points.push_back({ pos_x[pin.comp] + pin.dx, pos_y[pin.comp] + pin.dy });
+            total += buildSteinerTree(points).length();
+        }
+        return total;
+    }
+
+    double totalCost() const {
+        double cost = 0.0;
+        for (const auto& net : nets) cost += net.weight * net.box.hpwl();
+        return cost + rudy_weight * overflowCost();
+    }
+
+    // 拥挤度(RUDY)：每个线网把(w+h)/(w*h)的走线需求按面积均摊到包围盒覆盖的
+    // 格子上，格子需求超出容量的部分乘以rudy_weight计入成本
+    double rudy_weight = 0.0;
+    int bins_x = 0, bins_y = 0;
+    vector<double> bin_demand;
+
+    void enableCongestion(double weight, int area_w, int area_h) {
+        rudy_weight = weight;
+        bins_x = max(area_w, 1) / RUDY_BIN + 1;
+        bins_y = max(area_h, 1) / RUDY_BIN + 1;
+        bin_demand.assign(bins_x * bins_y, 0.0);
+        for (const auto& net : nets) rudyAdd(net.box, 1.0, [&](int b, double d) { bin_demand[b] += d; });
+    }
+
+    // 把线网包围盒的需求乘以sign逐格交给add(格子, 需求)
+    template <class Add>
+    void rudyAdd(const NetBox& b, double sign, Add add) const {
+        int w = b.max_x - b.min_x + 1, h = b.max_y - b.min_y + 1;
+        double density = sign * double(w + h) / (double(w) * h);
+        int bx0 = clamp(b.min_x / RUDY_BIN, 0, bins_x - 1), bx1 = clamp(b.max_x / RUDY_BIN, 0, bins_x - 1);
+        int by0 = clamp(b.min_y / RUDY_BIN, 0, bins_y - 1), by1 = clamp(b.max_y / RUDY_BIN, 0, bins_y - 1);
+        for (int by = by0; by <= by1; ++by) {
+            int oy = min(b.max_y + 1, (by + 1) * RUDY_BIN) - max(b.min_y, by * RUDY_BIN);
+            if (by == by0 || by == by1) oy = max(oy, 1);
+            for (int bx = bx0; bx <= bx1; ++bx) {
+                int ox = min(b.max_x + 1, (bx + 1) * RUDY_BIN) - max(b.min_x, bx * RUDY_BIN);
+                if (bx == bx0 || bx == bx1) ox = max(ox, 1);
+                add(by * bins_x + bx, density * ox * oy);
+            }
+        }
+    }
+
+    static double binOverflow(double demand) {
+        return max(0.0, demand - RUDY_CAPACITY * RUDY_BIN * RUDY_BIN);
+    }
+
+    double overflowCost() const {
+        double cost = 0.0;
+        for (double d : bin_demand) cost += binOverflow(d);
+        return cost;
+    }
+
+    // 评估一组移动带来的加权线长变化，不修改模型，涉及的包围盒写入scratch
+    double evalMoves(const CompMove* moves, int k, NetModelScratch& s) const {
+        updateBoxes(moves, k, s);
+        double delta = 0.0;
+        for (int t = 0; t < (int)s.touched.size(); ++t) {
+            const PlaceNet& net = nets[s.touched[t]];
+            delta += net.weight * (s.boxes[t].hpwl() - net.box.hpwl());
+        }
+        if (rudy_weight > 0) delta += rudy_weight * evalCongestion(s);
+        return delta;
+    }
+
+    // 同evalMoves，成本为定点整数（乘以COST_FX_ONE）
+    int64_t evalMovesFixed(const CompMove* moves, int k, NetModelScratch& s) const {
+        updateBoxes(moves, k, s);
+        int64_t delta = 0;
+        for (int t = 0; t < (int)s.touched.size(); ++t) {
+            const PlaceNet& net = nets[s.touched[t]];
+            delta += net.weight_fx * (s.boxes[t].hpwl() - net.box.hpwl());
+        }
+        if (rudy_weight > 0) delta += llround(rudy_weight * COST_FX_ONE * evalCongestion(s));
+        return delta;
+    }
+
+    // 移动后涉及的线网及其包围盒写入scratch
+    void updateBoxes(const CompMove* moves, int k, NetModelScratch& s) const {
+        if (s.slot.size() != nets.size()) s.slot.assign(nets.size(), -1);
+        for (int id : s.touched) s.slot[id] = -1;
+        s.touched.clear();
+        s.boxes.clear();
+        s.stale.clear();
+        for (int m = 0; m < k; ++m) {
+            const CompMove& mv = moves[m];
+            for (const auto& [id, pin_idx] : comp_pins[mv.comp]) {
+                if (s.slot[id] < 0) {
+                    s.slot[id] = s.touched.size();
+                    s.touched.push_back(id);
+                    s.boxes.push_back(nets[id].box);
+                    s.stale.push_back(false);
+                }
+                int t = s.slot[id];
+                if (s.stale[t]) continue;
+                const PinRef& pin = nets[id].pins[pin_idx];
+                NetBox& b = s.boxes[t];
+                int ox = pos_x[mv.comp] + pin.dx, oy = pos_y[mv.comp] + pin.dy;
+                int nx = mv.new_x + pin.dx, ny = mv.new_y + pin.dy;
+                // 先加入新位置再移除旧位置，向外移动的边界引脚无需重算
+                if (nx < b.min_x) { b.min_x = nx; b.n_min_x = 1; } else if (nx == b.min_x) b.n_min_x++;
+                if (nx > b.max_x) { b.max_x = nx; b.n_max_x = 1; } else if (nx == b.max_x) b.n_max_x++;
+                if (ny < b.min_y) { b.min_y = ny; b.n_min_y = 1; } else if (ny == b.min_y) b.n_min_y++;
+                if (ny > b.max_y) { b.max_y = ny; b.n_max_y = 1; } else if (ny == b.max_y) b.n_max_y++;
+                if (ox == b.min_x && --b.n_min_x == 0) s.stale[t] = true;
+                if (ox == b.max_x && --b.n_max_x == 0) s.stale[t] = true;
+                if (oy == b.min_y && --b.n_min_y == 0) s.stale[t] = true;
+                if (oy == b.max_y && --b.n_max_y == 0) s.stale[t] = true;
+            }
+        }
+        for (int t = 0; t < (int)s.touched.size(); ++t) {
+            if (s.stale[t]) s.boxes[t] = computeBox(nets[s.touched[t]], moves, k);
+        }
+    }
+
+    // 拥挤成本的变化：只看包围盒改变的线网覆盖的格子
+    double evalCongestion(NetModelScratch& s) const {
+        if (s.bin_delta.size() != bin_demand.size()) {
+            s.bin_delta.assign(bin_demand.size(), 0.0);
+            s.bin_seen.assign(bin_demand.size(), 0);
+        }
+        for (int b : s.bins) {
+            s.bin_delta[b] = 0.0;
+            s.bin_seen[b] = 0;
+        }
+        s.bins.clear();
+        auto add = [&](int b, double d) {
+            if (!s.bin_seen[b]) {
+                s.bin_seen[b] = 1;
+                s.bins.push_back(b);
+            }
+            s.bin_delta[b] += d;
+        };
+        for (int t = 0; t < (int)s.touched.size(); ++t) {
+            const NetBox& old_box = nets[s.touched[t]].box;
+            const NetBox& new_box = s.boxes[t];
+            if (old_box.min_x == new_box.min_x && old_box.max_x == new_box.max_x &&
+                old_box.min_y == new_box.min_y && old_box.max_y == new_box.max_y) continue;
+            rudyAdd(old_box, -1.0, add);
+            rudyAdd(new_box, 1.0, add);
         }
+        double delta = 0.0;
+        for (int b : s.bins) delta += binOverflow(bin_demand[b] + s.bin_delta[b]) - binOverflow(bin_demand[b]);
+        return delta;
     }
-    return cost;
+
+    // 接受移动：写回坐标与evalMoves算出的包围盒
+    void commit(const CompMove* moves, int k, const NetModelScratch& s) {
+        for (int m = 0; m < k; ++m) {
+            pos_x[moves[m].comp] = moves[m].new_x;
+            pos_y[moves[m].comp] = moves[m].new_y;
+            for (const auto& [id, pin_idx] : comp_pins[moves[m].comp]) {
+                const PlaceNet& net = nets[id];
+                pin_x[net.first + pin_idx] = moves[m].new_x + net.pins[pin_idx].dx;
+                pin_y[net.first + pin_idx] = moves[m].new_y + net.pins[pin_idx].dy;
+            }
+        }
+        for (int t = 0; t < (int)s.touched.size(); ++t) {
+            nets[s.touched[t]].box = s.boxes[t];
+        }
+        if (rudy_weight > 0) {
+            for (int b : s.bins) bin_demand[b] += s.bin_delta[b];
+        }
+    }
+};
+
+// 固定大小的线程池，parallelFor把[0, n)分给各工作线程，调用线程也参与
+class ThreadPool {
+public:
+    explicit ThreadPool(int num_workers) {
+        for (int i = 0; i < num_workers; ++i) workers.emplace_back([this] { workerLoop(); });
+    }
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(m);
+            stop = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) t.join();
+    }
+    void parallelFor(int n, const function<void(int)>& fn) {
+        if (workers.empty() || n <= 1) {
+            for (int i = 0; i < n; ++i) fn(i);
+            return;
+        }
+        {
+            lock_guard<mutex> lock(m);
+            job = &fn;
+            job_size = n;
+            next = 0;
+            active = workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        runJob(fn, n);
+        unique_lock<mutex> lock(m);
+        done.wait(lock, [this] { return active == 0; });
+        job = nullptr;
+    }
+
+private:
+    void runJob(const function<void(int)>& fn, int n) {
+        for (int i = next++; i < n; i = next++) fn(i);
+    }
+    void workerLoop() {
+        uint64_t seen = 0;
+        while (true) {
+            const function<void(int)>* fn;
+            int n;
+            {
+                unique_lock<mutex> lock(m);
+                wake.wait(lock, [&] { return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+                fn = job;
+                n = job_size;
+            }
+            runJob(*fn, n);
+            {
+                lock_guard<mutex> lock(m);
+                active--;
+            }
+            done.notify_one();
+        }
+    }
+    vector<thread> workers;
+    mutex m;
+    condition_variable wake, done;
+    const function<void(int)>* job = nullptr;
+    int job_size = 0;
+    atomic<int> next{ 0 };
+    size_t active = 0;
+    uint64_t generation = 0;
+    bool stop = false;
+};
+
+// 布线和批量退火共用的线程池
+ThreadPool& routePool() {
+    static ThreadPool pool(max(ROUTE_THREADS - 1, 0));
+    return pool;
 }
 
 // 计算模块面积成本（模块宽乘高）
 double calculate_size_cost(vector<shared_ptr<Component>>& components) {
-    int min_x = 100000, max_x = -100000, min_y = 100000, max_y = -100000;
-    for (const auto& comp : components) {
-        if (comp->type == "input" || comp->type == "output"
-            || comp->type == "power" || comp->type == "wire") continue;
-        if (comp->x < min_x) min_x = comp->x;
-        if (comp->x + comp->width > max_x) max_x = comp->x + comp->width;
-        if (comp->y < min_y) min_y = comp->y;
-        if (comp->y + comp->height > max_y) max_y = comp->y + comp->height;
-    }
-    int width = max_x - min_x;
-    int height = max_y - min_y;
-    return width * height;
+    CoreBBox box;
+    box.build(components);
+    return box.area();
 }
 
-void simulated_annealing(vector<shared_ptr<Component>>& components,
-    const unordered_map<string, vector<shared_ptr<Component>>>& in_map,
-    const unordered_map<string, vector<shared_ptr<Component>>>& out_map,
-    int width_bound,
-    int height_bound
-) {
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_int_distribution<int> comp_dist(0, components.size() - 1);
-    uniform_int_distribution<int> move_dist(0, 4);
-    uniform_int_distribution<int> layer_dist(-1, 1);
-    uniform_real_distribution<double> prob_dist(0.0, 1.0);
+// 天际线(Tetris)合法化：以元件当前坐标为期望位置，按期望y坐标排序扫描，
+// 每一列记录已占用的最高点，元件在期望x附近的窗口内选择位移最小的无重叠位置。
+// gap为同列上下元件的间距，y_limit>0时优先选择不超出该高度的位置
+void legalizeComponents(vector<shared_ptr<Component>>& comps, int gap, int y_limit) {
+    vector<shared_ptr<Component>> order;
+    int x_lo = INT_MAX, x_hi = INT_MIN;
+    for (const auto& comp : comps) {
+        if (comp->type == "wire" || comp->width <= 0) continue;
+        order.push_back(comp);
+        x_lo = min(x_lo, comp->x);
+        x_hi = max(x_hi, comp->x + comp->width);
+    }
+    if (order.empty()) return;
+    stable_sort(order.begin(), order.end(), [](const shared_ptr<Component>& a, const shared_ptr<Component>& b) {
+        return a->y != b->y ? a->y < b->y : a->x < b->x;
+    });
+
+    // front[c]：第c列（x = base + c）最低的可用y
+    int base = x_lo - LEGAL_WINDOW;
+    vector<int> front(x_hi - base + LEGAL_WINDOW + 1, INT_MIN);
+    for (auto& comp : order) {
+        int want_c = comp->x - base;
+        int best_c = -1, best_y = 0;
+        long long best_cost = LLONG_MAX;
+        bool best_fits = false;
+        for (int d = 0; d <= LEGAL_WINDOW; ++d) {
+            if (best_fits && d >= best_cost) break;
+            for (int c : { want_c - d, want_c + d }) {
+                if (c < 0 || c + comp->width > (int)front.size()) continue;
+                int y = comp->y;
+                for (int k = c; k < c + comp->width; ++k) y = max(y, front[k]);
+                bool fits = y_limit <= 0 || y + comp->height <= y_limit;
+                long long cost = (long long)d + (y - comp->y);
+                if ((fits && !best_fits) || (fits == best_fits && cost < best_cost)) {
+                    best_c = c;
+                    best_y = y;
+                    best_cost = cost;
+                    best_fits = fits;
+                }
+                if (d == 0) break;
+            }
+        }
+        comp->x = base + best_c;
+        comp->y = best_y;
+        for (int k = best_c; k < best_c + comp->width; ++k) front[k] = best_y + comp->height + gap;
+    }
+}
 
+// 退火的初始最大步长：元件平均边长乘以(1+ln n)
+int annealMaxStep(const vector<shared_ptr<Component>>& components) {
     // 计算元件平均边长
     int tatolsi = 0;
     for (auto one : components) {
@@ -322,21 +1430,323 @@ void simulated_annealing(vector<shared_ptr<Component>>& components,
         cout << "好小的初始步长，是不是哪里错了" << endl;
         step_max0 = component_sizes["nmos"].first;
     }
+    return step_max0;
+}
 
-    // 模拟退火
-    double temp = INIT_TEMP;
+// 退火进度条，百分比变化时才刷新
+void annealProgress(double temp, double init_temp, int& ecount) {
+    int progress_percent = static_cast<int>(100 * ( log(temp / init_temp) / log(MIN_TEMP / init_temp)));
+    progress_percent = max(0, min(100, progress_percent));
+    if (progress_percent != ecount){
+        ecount = progress_percent;
+        cout << "\r[";
+        int bar_length = 50;
+        int filled_length = (ecount * bar_length) / 100;
+        for (int i = 0; i < bar_length; ++i) {
+            cout << (i < filled_length ? '=' : ' ');
+        }
+        cout << "] " << ecount << "%";
+        cout.flush();
+    }
+}
+
+// xoshiro256**随机数发生器，比mt19937快且状态只有32字节
+struct Xoshiro256 {
+    uint64_t s[4];
+    explicit Xoshiro256(uint64_t seed) {
+        // 用splitmix64展开种子
+        for (auto& word : s) {
+            uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            word = z ^ (z >> 31);
+        }
+    }
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    uint64_t next() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9, t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+    // [0, n)内的均匀整数（乘法取高位，不用取模）
+    uint32_t below(uint32_t n) { return uint32_t(((next() >> 32) * n) >> 32); }
+    // (0, 1]内的均匀实数
+    double unit() { return double((next() >> 11) + 1) * (1.0 / 9007199254740992.0); }
+};
+
+// 定点退火内核：线长和面积成本都是乘以COST_FX_ONE的整数，面积只在移动时重算
+// 新包围盒；Metropolis准则改写为 delta < T·(-ln u)，每个温度先成批算好各步的
+// 阈值，步内只剩一次整数比较。移动和交换的规则与浮点内核相同
+void annealFixedPoint(vector<shared_ptr<Component>>& components,
+    const unordered_map<string, vector<shared_ptr<Component>>>& in_map,
+    const unordered_map<string, vector<shared_ptr<Component>>>& out_map,
+    int width_bound, int height_bound, double init_temp, double congestion_weight) {
+    int n = components.size();
+    vector<int> movable;
+    // 元件坐标和尺寸摊平成数组，重叠检查和面积计算不再经过shared_ptr和类型字符串
+    vector<int> px(n), py(n), pw(n), ph(n), pl(n);
+    for (int i = 0; i < n; ++i) {
+        const auto& c = *components[i];
+        if (!c.fixed) movable.push_back(i);
+        px[i] = c.x; py[i] = c.y; pw[i] = c.width; ph[i] = c.height; pl[i] = c.layer;
+    }
+    if (movable.empty()) return;
+    Xoshiro256 rng(RANDOM_SEED >= 0 ? (uint64_t)RANDOM_SEED : random_device{}());
+
+    NetModel model;
+    model.build(components, in_map, out_map);
+    if (congestion_weight > 0) model.enableCongestion(congestion_weight, width_bound, height_bound);
+    NetModelScratch scratch;
+
+    CoreBBox box;
+    box.build(components);
+    CompRects rects;
+    rects.build(components);
+
+    int step_max0 = annealMaxStep(components);
+    long long area = box.area();
+    vector<double> limit(SA_STEPS);
+    double temp = init_temp;
     int ecount = 0;
     while (temp > MIN_TEMP) {
-        // 计算当前最大步长
-        double progress = (temp / INIT_TEMP);
-        progress = max(0.0, min(1.0, progress));
-        int current_max_step = progress * progress * step_max0;
-        if (current_max_step < step_max0 / 4) current_max_step = step_max0 / 4;
-
-        // 创建位置分布
-        uniform_int_distribution<int> pos_dist(-current_max_step, current_max_step);
+        double progress = max(0.0, min(1.0, temp / init_temp));
+        int max_step = max(int(progress * progress * step_max0), step_max0 / 4);
+        double dp = (1 - progress) < 0.001 ? 1000 : 1 / (1 - progress);
+        dp = (dp - 1) < 0.01 ? 0.01 : dp - 1;
+        int64_t size_fx = llround(SIZE_WEIGHT * dp * COST_FX_ONE);
+        // 本温度下各步的接受阈值，定点单位
+        double temp_fx = temp * COST_FX_ONE;
+        for (int step = 0; step < SA_STEPS; ++step) limit[step] = temp_fx * -log(rng.unit());
 
         for (int step = 0; step < SA_STEPS; ++step) {
+            if (rng.next() >> 63) {
+                int idx = movable[rng.below(movable.size())];
+                if (!box.core(idx)) continue;
+                int new_x = px[idx] + int(rng.below(2 * max_step + 1)) - max_step;
+                int new_y = py[idx] + int(rng.below(2 * max_step + 1)) - max_step;
+                new_x = max(0, min(width_bound - pw[idx], new_x));
+                new_y = max(0, min(height_bound - ph[idx], new_y));
+                if (rects.overlaps(idx, new_x, new_y, pl[idx], false)) continue;
+                long long new_area = box.areaWith(idx, new_x, new_y);
+                CompMove mv = { idx, new_x, new_y };
+                int64_t delta = model.evalMovesFixed(&mv, 1, scratch) + size_fx * (new_area - area);
+                if (delta < limit[step]) {
+                    model.commit(&mv, 1, scratch);
+                    px[idx] = new_x;
+                    py[idx] = new_y;
+                    rects.set(idx, new_x, new_y, pl[idx]);
+                    box.set(idx, new_x, new_y);
+                    area = new_area;
+                }
+            }
+            else {
+                int i1 = movable[rng.below(movable.size())];
+                int i2 = movable[rng.below(movable.size())];
+                if (i1 == i2 || !box.core(i1) || !box.core(i2)) continue;
+                // 交换时对方已在自己的旧位置上
+                auto swapBoth = [&] {
+                    swap(px[i1], px[i2]);
+                    swap(py[i1], py[i2]);
+                    swap(pl[i1], pl[i2]);
+                    rects.set(i1, px[i1], py[i1], pl[i1]);
+                    rects.set(i2, px[i2], py[i2], pl[i2]);
+                };
+                swapBoth();
+                if (rects.overlaps(i1, px[i1], py[i1], pl[i1], true) || rects.overlaps(i2, px[i2], py[i2], pl[i2], true)) {
+                    swapBoth();
+                    continue;
+                }
+                CompMove mvs[2] = { { i1, px[i1], py[i1] }, { i2, px[i2], py[i2] } };
+                int64_t delta = model.evalMovesFixed(mvs, 2, scratch);
+                if (delta < limit[step]) {
+                    model.commit(mvs, 2, scratch);
+                    box.set(i1, px[i1], py[i1]);
+                    box.set(i2, px[i2], py[i2]);
+                    if (pw[i1] != pw[i2] || ph[i1] != ph[i2]) area = box.area();
+                }
+                else swapBoth();
+            }
+        }
+        temp *= COOLING_RATE;
+        annealProgress(temp, init_temp, ecount);
+    }
+    cout << "\n";
+    for (int i = 0; i < n; ++i) {
+        components[i]->x = px[i];
+        components[i]->y = py[i];
+        components[i]->layer = pl[i];
+    }
+}
+
+// 浮点退火内核
+void annealFloat(vector<shared_ptr<Component>>& components,
+    const unordered_map<string, vector<shared_ptr<Component>>>& in_map,
+    const unordered_map<string, vector<shared_ptr<Component>>>& out_map,
+    int width_bound,
+    int height_bound,
+    double init_temp,
+    double congestion_weight
+) {
+    // 只在未固定的元件中抽样
+    vector<int> movable;
+    for (int i = 0; i < (int)components.size(); ++i) {
+        if (!components[i]->fixed) movable.push_back(i);
+    }
+    if (movable.empty()) return;
+    random_device rd;
+    mt19937 gen(RANDOM_SEED >= 0 ? (unsigned)RANDOM_SEED : rd());
+    uniform_int_distribution<int> pick_dist(0, movable.size() - 1);
+    auto comp_dist = [&](mt19937& g) { return movable[pick_dist(g)]; };
+    uniform_int_distribution<int> move_dist(0, 4);
+    uniform_int_distribution<int> layer_dist(-1, 1);
+    uniform_real_distribution<double> prob_dist(0.0, 1.0);
+
+    // 构建线网模型
+    NetModel model;
+    model.build(components, in_map, out_map);
+    if (congestion_weight > 0) model.enableCongestion(congestion_weight, width_bound, height_bound);
+    NetModelScratch scratch;
+    CoreBBox box;
+    box.build(components);
+    double size_cost = box.area();
+    CompRects rects;
+    rects.build(components);
+
+    // 批量退火：一批提议按顺序生成（随机数只在这里消耗），各提议对照同一份快照
+    // 并行评估；再按提议顺序提交被接受且互不冲突的（不共用元件和线网、新位置
+    // 互不重叠），与已提交者冲突的视为拒绝。结果与线程数无关
+    struct Proposal {
+        CompMove mv[2];
+        int layer[2];
+        int k = 0;          // 移动的元件数，0为空提议
+        double u = 0.0;     // Metropolis准则的均匀抽样
+        double delta = 0.0;
+        bool accept = false;
+    };
+    vector<Proposal> batch;
+    vector<NetModelScratch> batch_scratch;
+    vector<char> comp_taken(components.size(), 0), net_taken(model.nets.size(), 0);
+    long long batch_proposed = 0, batch_conflicts = 0;
+    auto isPort = [&](int i) { return !box.core(i); };
+    // 提议生效后被移动的元件是否与其他元件重叠（与逐个评估一致：移动时不看wire）。
+    // rects是本批开始时的快照；交换时跳过对方的旧位置，另查两者的新位置
+    auto proposalOverlaps = [&](const Proposal& p) {
+        for (int m = 0; m < p.k; ++m) {
+            int other = p.k == 2 ? p.mv[1 - m].comp : -1;
+            if (rects.overlaps(p.mv[m].comp, p.mv[m].new_x, p.mv[m].new_y, p.layer[m], p.k == 2, other)) return true;
+        }
+        if (p.k < 2) return false;
+        const auto& c1 = *components[p.mv[0].comp];
+        const auto& c2 = *components[p.mv[1].comp];
+        return p.layer[0] == p.layer[1] && p.mv[0].new_x < p.mv[1].new_x + c2.width && p.mv[0].new_x + c1.width > p.mv[1].new_x &&
+            p.mv[0].new_y < p.mv[1].new_y + c2.height && p.mv[0].new_y + c1.height > p.mv[1].new_y;
+    };
+    auto runBatch = [&](int count, double temp, double dp, uniform_int_distribution<int>& pos_dist) {
+        batch.assign(count, Proposal());
+        if ((int)batch_scratch.size() < count) batch_scratch.resize(count);
+        for (auto& p : batch) {
+            if (prob_dist(gen) < 0.5) {
+                int idx = comp_dist(gen);
+                if (isPort(idx)) continue;
+                const auto& comp = *components[idx];
+                int dx = pos_dist(gen), dy = pos_dist(gen);
+                p.mv[0] = { idx, max(0, min(width_bound - comp.width, comp.x + dx)), max(0, min(height_bound - comp.height, comp.y + dy)) };
+                p.layer[0] = comp.layer;
+                p.k = 1;
+            }
+            else {
+                int idx1 = comp_dist(gen), idx2 = comp_dist(gen);
+                if (idx1 == idx2 || isPort(idx1) || isPort(idx2)) continue;
+                const auto& c1 = *components[idx1];
+                const auto& c2 = *components[idx2];
+                p.mv[0] = { idx1, c2.x, c2.y };
+                p.mv[1] = { idx2, c1.x, c1.y };
+                p.layer[0] = c2.layer;
+                p.layer[1] = c1.layer;
+                p.k = 2;
+            }
+            p.u = prob_dist(gen);
+        }
+        routePool().parallelFor(count, [&](int i) {
+            Proposal& p = batch[i];
+            if (p.k == 0 || proposalOverlaps(p)) return;
+            p.delta = model.evalMoves(p.mv, p.k, batch_scratch[i]);
+            if (p.k == 1) {
+                // 面积成本：把移动的元件换到新位置后重算包围盒
+                p.delta += SIZE_WEIGHT * dp * (box.areaWith(p.mv[0].comp, p.mv[0].new_x, p.mv[0].new_y) - size_cost);
+            }
+            p.accept = p.delta < 0 || p.u < exp(-p.delta / temp);
+        });
+        vector<int> taken_comps, taken_nets;
+        vector<CompMove> placed;
+        for (int i = 0; i < count; ++i) {
+            Proposal& p = batch[i];
+            batch_proposed++;
+            if (!p.accept) continue;
+            const NetModelScratch& s = batch_scratch[i];
+            bool conflict = false;
+            for (int m = 0; m < p.k; ++m) conflict = conflict || comp_taken[p.mv[m].comp];
+            for (int id : s.touched) conflict = conflict || net_taken[id];
+            for (int m = 0; m < p.k && !conflict; ++m) {
+                const auto& comp = *components[p.mv[m].comp];
+                for (const auto& q : placed) {
+                    const auto& other = *components[q.comp];
+                    if (other.layer == p.layer[m] && p.mv[m].new_x < q.new_x + other.width && p.mv[m].new_x + comp.width > q.new_x &&
+                        p.mv[m].new_y < q.new_y + other.height && p.mv[m].new_y + comp.height > q.new_y) conflict = true;
+                }
+            }
+            if (conflict) {
+                batch_conflicts++;
+                continue;
+            }
+            for (int m = 0; m < p.k; ++m) {
+                auto& comp = *components[p.mv[m].comp];
+                comp.x = p.mv[m].new_x;
+                comp.y = p.mv[m].new_y;
+                comp.layer = p.layer[m];
+                box.set(p.mv[m].comp, comp.x, comp.y);
+                rects.set(p.mv[m].comp, comp.x, comp.y, comp.layer);
+                comp_taken[p.mv[m].comp] = 1;
+                taken_comps.push_back(p.mv[m].comp);
+                placed.push_back(p.mv[m]);
+            }
+            for (int id : s.touched) {
+                net_taken[id] = 1;
+                taken_nets.push_back(id);
+            }
+            model.commit(p.mv, p.k, s);
+        }
+        size_cost = box.area();
+        for (int c : taken_comps) comp_taken[c] = 0;
+        for (int id : taken_nets) net_taken[id] = 0;
+    };
+
+    int step_max0 = annealMaxStep(components);
+
+    // 模拟退火
+    double temp = init_temp;
+    int ecount = 0;
+    while (temp > MIN_TEMP) {
+        // 计算当前最大步长
+        double progress = (temp / init_temp);
+        progress = max(0.0, min(1.0, progress));
+        int current_max_step = progress * progress * step_max0;
+        if (current_max_step < step_max0 / 4) current_max_step = step_max0 / 4;
+
+        // 创建位置分布
+        uniform_int_distribution<int> pos_dist(-current_max_step, current_max_step);
+
+        double dp = (1 - progress) < 0.001 ? 1000 : 1 / (1 - progress);
+        dp = (dp - 1) < 0.01 ? 0.01 : dp - 1;
+        for (int step = 0; SA_BATCH > 0 && step < SA_STEPS; step += SA_BATCH) {
+            runBatch(min(SA_BATCH, SA_STEPS - step), temp, dp, pos_dist);
+        }
+        for (int step = 0; SA_BATCH == 0 && step < SA_STEPS; ++step) {
             double action = prob_dist(gen);
 
             // 50%概率移动元件，50%概率交换元件
@@ -346,8 +1756,7 @@ void simulated_annealing(vector<shared_ptr<Component>>& components,
                 shared_ptr<Component> comp = components[idx];
 
                 // 跳过输入端口和电源和线
-                if (comp->type == "input" || comp->type == "power"
-                    || comp->type == "output" || comp->type == "wire") continue;
+                if (!box.core(idx)) continue;
 
                 // 保存原位置
                 int old_x = comp->x;
@@ -377,14 +1786,7 @@ void simulated_annealing(vector<shared_ptr<Component>>& components,
                 comp->layer = new_layer;
 
                 // 检查是否与其他元件重叠
-                bool overlap = false;
-                for (auto& other : components) {
-                    if (comp == other || other->type == "output" || other->type == "wire") continue;
-                    if (comp->overlaps(other)) {
-                        overlap = true;
-                        break;
-                    }
-                }
+                bool overlap = rects.overlaps(idx, new_x, new_y, new_layer, false);
 
                 if (overlap) {
                     // 恢复原位置并跳过
@@ -395,24 +1797,18 @@ void simulated_annealing(vector<shared_ptr<Component>>& components,
                 }
 
                 // 计算成本变化
-                comp->x = old_x;
-                comp->y = old_y;
-                comp->layer = old_layer;
-                double old_size_cost = calculate_size_cost(components);
-                double old_cost = calculate_component_cost(progress, comp, in_map, out_map);
-                comp->x = new_x;
-                comp->y = new_y;
-                comp->layer = new_layer;
-                double new_size_cost = calculate_size_cost(components);
-                double new_cost = calculate_component_cost(progress, comp, in_map, out_map);
-                double line_delta = new_cost - old_cost;
-                double size_delta = new_size_cost - old_size_cost;
-                double dp = (1 - progress) < 0.001 ? 1000 : 1 / (1 - progress);
-                dp = (dp - 1) < 0.01 ? 0.01 : dp - 1;
+                double new_size_cost = box.areaWith(idx, new_x, new_y);
+                CompMove mv = { idx, new_x, new_y };
+                double line_delta = model.evalMoves(&mv, 1, scratch);
+                double size_delta = new_size_cost - size_cost;
                 double delta = line_delta + SIZE_WEIGHT * dp * size_delta;
                 // Metropolis准则
                 if (delta < 0 || prob_dist(gen) < exp(-delta / temp)) {
                     // 接受移动
+                    model.commit(&mv, 1, scratch);
+                    box.set(idx, new_x, new_y);
+                    rects.set(idx, new_x, new_y, new_layer);
+                    size_cost = new_size_cost;
                 }
                 else {
                     // 拒绝移动，恢复原位置
@@ -431,8 +1827,7 @@ void simulated_annealing(vector<shared_ptr<Component>>& components,
                 shared_ptr<Component> comp2 = components[idx2];
 
                 // 跳过端口和电源
-                if (comp1->type == "input" || comp1->type == "power" || comp1->type == "output" || comp1->type == "wire"
-                    || comp2->type == "input" || comp2->type == "power" || comp2->type == "output" || comp2->type == "wire") continue;
+                if (!box.core(idx1) || !box.core(idx2)) continue;
 
                 // 保存原位置
                 int old_x1 = comp1->x, old_y1 = comp1->y, old_layer1 = comp1->layer;
@@ -447,26 +1842,15 @@ void simulated_annealing(vector<shared_ptr<Component>>& components,
                 comp2->layer = old_layer1;
 
                 // 检查是否与其他元件重叠
-                bool overlap = false;
-                for (auto& other : components) {
-                    if (other->type == "output") continue;
-                    if (comp1 != other && comp1->overlaps(other)) {
-                        overlap = true;
-                        break;
-                    }
-                }
-                if (!overlap) {
-                    for (auto& other : components) {
-                        if (other->type == "output") continue;
-                        if (comp2 != other && comp2->overlaps(other)) {
-                            overlap = true;
-                            break;
-                        }
-                    }
-                }
+                rects.set(idx1, old_x2, old_y2, old_layer2);
+                rects.set(idx2, old_x1, old_y1, old_layer1);
+                bool overlap = rects.overlaps(idx1, old_x2, old_y2, old_layer2, true)
+                    || rects.overlaps(idx2, old_x1, old_y1, old_layer1, true);
 
                 if (overlap) {
                     // 恢复原位置并跳过
+                    rects.set(idx1, old_x1, old_y1, old_layer1);
+                    rects.set(idx2, old_x2, old_y2, old_layer2);
                     comp1->x = old_x1;
                     comp1->y = old_y1;
                     comp1->layer = old_layer1;
@@ -477,30 +1861,21 @@ void simulated_annealing(vector<shared_ptr<Component>>& components,
                 }
 
                 // 计算成本变化
-                comp1->x = old_x1;
-                comp1->y = old_y1;
-                comp1->layer = old_layer1;
-                comp2->x = old_x2;
-                comp2->y = old_y2;
-                comp2->layer = old_layer2;
-                double old_cost = calculate_component_cost(progress, comp1, in_map, out_map) +
-                    calculate_component_cost(progress, comp2, in_map, out_map);
-                comp1->x = old_x2;
-                comp1->y = old_y2;
-                comp1->layer = old_layer2;
-                comp2->x = old_x1;
-                comp2->y = old_y1;
-                comp2->layer = old_layer1;
-                double new_cost = calculate_component_cost(progress, comp1, in_map, out_map) +
-                    calculate_component_cost(progress, comp2, in_map, out_map);
-                double delta = new_cost - old_cost;
+                CompMove mvs[2] = { { idx1, old_x2, old_y2 }, { idx2, old_x1, old_y1 } };
+                double delta = model.evalMoves(mvs, 2, scratch);
 
                 // Metropolis准则
                 if (delta < 0 || prob_dist(gen) < exp(-delta / temp)) {
                     // 接受交换
+                    model.commit(mvs, 2, scratch);
+                    box.set(idx1, old_x2, old_y2);
+                    box.set(idx2, old_x1, old_y1);
+                    if (comp1->width != comp2->width || comp1->height != comp2->height) size_cost = box.area();
                 }
                 else {
                     // 拒绝交换，恢复原位置
+                    rects.set(idx1, old_x1, old_y1, old_layer1);
+                    rects.set(idx2, old_x2, old_y2, old_layer2);
                     comp1->x = old_x1;
                     comp1->y = old_y1;
                     comp1->layer = old_layer1;
@@ -511,86 +1886,101 @@ void simulated_annealing(vector<shared_ptr<Component>>& components,
             }
         }
         temp *= COOLING_RATE;
-        int progress_percent = static_cast<int>(100 * ( log(temp/INIT_TEMP) / log(MIN_TEMP / INIT_TEMP)));
-        progress_percent = max(0, min(100, progress_percent));
-        if (progress_percent != ecount){
-            ecount = progress_percent;
-            cout << "\r[";
-            int bar_length = 50;
-            int filled_length = (ecount * bar_length) / 100;
-            for (int i = 0; i < bar_length; ++i) {
-                cout << (i < filled_length ? '=' : ' ');
-            }
-            cout << "] " << ecount << "%";
-            cout.flush();
-        }
-        
+        annealProgress(temp, init_temp, ecount);
     }
     cout << "\n";
+    if (SA_BATCH > 0) cout << "批量退火：提议" << batch_proposed << "次，因冲突放弃" << batch_conflicts << "次" << endl;
 }
 
-// 应用力导向与模拟退火布局
-void mixed_layout(vector<shared_ptr<Component>>& components,
+void simulated_annealing(vector<shared_ptr<Component>>& components,
     const unordered_map<string, vector<shared_ptr<Component>>>& in_map,
     const unordered_map<string, vector<shared_ptr<Component>>>& out_map,
-    int width_bound, int height_bound) {
-    int time = 0;
-    while (time < CIRCLE) {
-        simulated_annealing(components, in_map, out_map, width_bound, height_bound);
-        // 计算尺寸
-        int min_x = 1000000, max_x = -1000000;
-        int min_y = 1000000, max_y = -1000000;
-        int count = 0;
-        for (const auto& comp : components) {
-            if (comp->type == "input" || comp->type == "power" ||
-                comp->type == "output" || comp->type == "wire") {
-                continue; // 跳过特殊元件
-            }
-            min_x = min(min_x, comp->x);
-            max_x = max(max_x, comp->x + comp->width);
-            min_y = min(min_y, comp->y);
-            max_y = max(max_y, comp->y + comp->height);
-            count++;
-        }
-
-        // 调整特殊元件位置
-        if (count > 0) {
-            int input_y = min_y;
-            int output_y = min_y;
-            if (0) {
-                for (auto& comp : components) {
-                    if (comp->type == "input" || comp->type == "power") {
-                        comp->x = max(min_x - comp->width, comp->x);
-                        comp->y = input_y;
-                        input_y += comp->height; // 垂直排列
-                    }
-                    else if (comp->type == "output") {
-                        comp->x = min(max_x, comp->x);
-                        comp->y = output_y;
-                        output_y += comp->height; // 垂直排列
-                    }
+    int width_bound,
+    int height_bound,
+    double init_temp = INIT_TEMP,
+    double congestion_weight = CONGESTION_WEIGHT
+) {
+    auto started = chrono::steady_clock::now();
+    if (SA_KERNEL == 1) annealFixedPoint(components, in_map, out_map, width_bound, height_bound, init_temp, congestion_weight);
+    else annealFloat(components, in_map, out_map, width_bound, height_bound, init_temp, congestion_weight);
+    cout << "退火用时" << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count()
+        << "ms（" << simd::kernels().name << "）" << endl;
+}
+
+// 将输入/电源端口排在核心元件左侧、输出端口排在右侧，并把整体平移到原点
+void arrangePorts(vector<shared_ptr<Component>>& components) {
+    // 计算尺寸
+    int min_x = 1000000, max_x = -1000000;
+    int min_y = 1000000, max_y = -1000000;
+    int count = 0;
+    for (const auto& comp : components) {
+        if (comp->type == "input" || comp->type == "power" ||
+            comp->type == "output" || comp->type == "wire") {
+            continue; // 跳过特殊元件
+        }
+        min_x = min(min_x, comp->x);
+        max_x = max(max_x, comp->x + comp->width);
+        min_y = min(min_y, comp->y);
+        max_y = max(max_y, comp->y + comp->height);
+        count++;
+    }
+
+    // 调整特殊元件位置
+    if (count > 0) {
+        int input_y = min_y;
+        int output_y = min_y;
+        if (0) {
+            for (auto& comp : components) {
+                if (comp->type == "input" || comp->type == "power") {
+                    comp->x = max(min_x - comp->width, comp->x);
+                    comp->y = input_y;
+                    input_y += comp->height; // 垂直排列
+                }
+                else if (comp->type == "output") {
+                    comp->x = min(max_x, comp->x);
+                    comp->y = output_y;
+                    output_y += comp->height; // 垂直排列
                 }
             }
-            else {
-                for (auto& comp : components) {
-                    if (comp->type == "input" || comp->type == "power") {
-                        comp->x = min_x - comp->width;
-                        comp->y = input_y;
-                        input_y += comp->height; // 垂直排列
-                    }
-                    else if (comp->type == "output") {
-                        comp->x = max_x;
-                        comp->y = output_y;
-                        output_y += comp->height; // 垂直排列
-                    }
+        }
+        else {
+            for (auto& comp : components) {
+                if (comp->type == "input" || comp->type == "power") {
+                    comp->x = min_x - comp->width;
+                    comp->y = input_y;
+                    input_y += comp->height; // 垂直排列
+                }
+                else if (comp->type == "output") {
+                    comp->x = max_x;
+                    comp->y = output_y;
+                    output_y += comp->height; // 垂直排列
                 }
             }
         }
-        // 将所有元件平移min_x,min_y
-        for (auto& comp : components) {
-            comp->x -= min_x;
-            comp->y -= min_y;
+    }
+    // 将所有元件平移min_x,min_y
+    for (auto& comp : components) {
+        comp->x -= min_x;
+        comp->y -= min_y;
+    }
+}
+
+// 应用力导向与模拟退火布局
+void mixed_layout(vector<shared_ptr<Component>>& components,
+    const unordered_map<string, vector<shared_ptr<Component>>>& in_map,
+    const unordered_map<string, vector<shared_ptr<Component>>>& out_map,
+    int width_bound, int height_bound, double init_temp = INIT_TEMP) {
+    int time = 0;
+    while (time < CIRCLE) {
+        simulated_annealing(components, in_map, out_map, width_bound, height_bound, init_temp);
+        // 合法化退火结果（无重叠时不改变位置）
+        vector<shared_ptr<Component>> core;
+        for (const auto& comp : components) {
+            if (comp->type != "input" && comp->type != "power" &&
+                comp->type != "output" && comp->type != "wire") core.push_back(comp);
         }
+        legalizeComponents(core, 0, 0);
+        arrangePorts(components);
         time++;
     }
 }
@@ -658,62 +2048,56 @@ json subModuleToLayoutJson(const SubModuleNode& module, const int offset_x, cons
     return j;
 }
 
-json subModuleToRouteJson(const SubModuleNode& rootModule, int x, int y) {
-
+json subModuleToRouteJson(const SubModuleNode& module, int x, int y) {
     json routeJson;
-    queue<shared_ptr<const SubModuleNode>> q;
-    q.push(make_shared<const SubModuleNode>(rootModule));
-    routeJson["name"] = rootModule.name;
-    routeJson["module_name"] = rootModule.module_name;
-    while (!q.empty()) {
-        auto module = q.front();
-        q.pop();
-
-        // 记录当前模块的nets
-        for (auto& net : module->nets) {
-            json netJson;
-            netJson["name"] = net->name;
-
-            netJson["pins"] = json::array();
-            // 转换引脚
-            for (auto& pin : net->pins) {
-                json pinJson;
-                pinJson["x"] = pin->pos.x + x;
-                pinJson["y"] = pin->pos.y + y;
-                pinJson["layer"] = pin->layer;
-                netJson["pins"].push_back(pinJson);
-            }
-
-            // 转换线段
-            for (auto& seg : net->segments) {
-                json segJson;
-                segJson["start"] = { {"x", x + seg.start.x}, {"y", y + seg.start.y} };
-                segJson["end"] = { {"x", x + seg.end.x}, {"y", y + seg.end.y} };
-                segJson["layer"] = seg.layer;
-                netJson["segments"].push_back(segJson);
-            }
+    routeJson["name"] = module.name;
+    routeJson["module_name"] = module.module_name;
+
+    // 记录当前模块的nets，已溢出的从磁盘读回，用完即释放
+    vector<shared_ptr<Net>> spilled;
+    if (!module.spill_path.empty()) spilled = loadSpilledNets(module);
+    for (auto& net : module.spill_path.empty() ? module.nets : spilled) {
+        json netJson;
+        netJson["name"] = net->name;
+
+        netJson["pins"] = json::array();
+        // 转换引脚
+        for (auto& pin : net->pins) {
+            json pinJson;
+            pinJson["x"] = pin->pos.x + x;
+            pinJson["y"] = pin->pos.y + y;
+            pinJson["layer"] = pin->layer;
+            netJson["pins"].push_back(pinJson);
+        }
 
-            // 转换过孔
-            for (auto& via : net->vias) {
-                json viaJson;
-                viaJson["x"] = x + via.x;
-                viaJson["y"] = y + via.y;
-                netJson["vias"].push_back(viaJson);
-            }
+        // 转换线段
+        for (auto& seg : net->segments) {
+            json segJson;
+            segJson["start"] = { {"x", x + seg.start.x}, {"y", y + seg.start.y} };
+            segJson["end"] = { {"x", x + seg.end.x}, {"y", y + seg.end.y} };
+            segJson["layer"] = seg.layer;
+            netJson["segments"].push_back(segJson);
+        }
 
-            routeJson["nets"].push_back(netJson);
+        // 转换过孔
+        for (auto& via : net->vias) {
+            json viaJson;
+            viaJson["x"] = x + via.x;
+            viaJson["y"] = y + via.y;
+            netJson["vias"].push_back(viaJson);
         }
 
-        // 处理子模块
-        routeJson["subModules"] = json::object();
-        for (auto& comp : module->components) {
-            if (comp->pSubModuleNode) {
-                comp->pSubModuleNode;
-                json subJson = subModuleToRouteJson(*comp->pSubModuleNode, x + comp->x, y + comp->y);
-                routeJson["subModules"][comp->name] = subJson;
-            }
+        routeJson["nets"].push_back(netJson);
+    }
+
+    // 处理子模块
+    json subModules = json::object();
+    for (auto& comp : module.components) {
+        if (comp->pSubModuleNode) {
+            subModules[comp->name] = subModuleToRouteJson(*comp->pSubModuleNode, x + comp->x, y + comp->y);
         }
     }
+    routeJson["subModules"] = subModules;
     return routeJson;
 }
 
@@ -745,6 +2129,385 @@ void outputLayoutToJson(const SubModuleNode& rootModule, const string& filename)
     }
 }
 
+// 展平几何导出：一次遍历实例树，按绝对坐标逐个写出形状，不在内存中拼整棵JSON。
+// path是实例路径（顶层模块名/实例名/...），同类型的各实例共享模块数据，不做拷贝
+struct GeometryWriter {
+    virtual ~GeometryWriter() {}
+    virtual void cell(const string& path, const string& name, const string& type, int x, int y, int w, int h, int layer) = 0;
+    virtual void segment(const string& path, const string& net, int layer, int x1, int y1, int x2, int y2) = 0;
+    virtual void via(const string& path, const string& net, int x, int y) = 0;
+    virtual void finish() = 0;
+};
+
+// {"shapes":[...]}，每个形状一行
+struct JsonGeometryWriter : GeometryWriter {
+    ostream& out;
+    bool first = true;
+    explicit JsonGeometryWriter(ostream& o) : out(o) { out << "{\"shapes\":["; }
+    void emit(const json& shape) {
+        out << (first ? "\n" : ",\n") << shape.dump();
+        first = false;
+    }
+    void cell(const string& path, const string& name, const string& type, int x, int y, int w, int h, int layer) override {
+        emit({ {"kind", "cell"}, {"path", path}, {"name", name}, {"type", type},
+               {"x", x}, {"y", y}, {"width", w}, {"height", h}, {"layer", layer} });
+    }
+    void segment(const string& path, const string& net, int layer, int x1, int y1, int x2, int y2) override {
+        emit({ {"kind", "segment"}, {"path", path}, {"net", net}, {"layer", layer},
+               {"x1", x1}, {"y1", y1}, {"x2", x2}, {"y2", y2} });
+    }
+    void via(const string& path, const string& net, int x, int y) override {
+        emit({ {"kind", "via"}, {"path", path}, {"net", net}, {"x", x}, {"y", y} });
+    }
+    void finish() override { out << "\n]}\n"; }
+};
+
+// 二进制格式：8字节魔数"RTGEO1\0\0"后是一串记录，每条以1字节种类开头，整数均为小端int32。
+// 0 字符串：id、长度、字节（首次用到某字符串前写出）
+// 1 元件：path、name、type、x、y、width、height、layer
+// 2 线段：path、net、layer、x1、y1、x2、y2
+// 3 过孔：path、net、x、y
+// 4 结束
+struct BinaryGeometryWriter : GeometryWriter {
+    ostream& out;
+    unordered_map<string, int32_t> ids;
+    explicit BinaryGeometryWriter(ostream& o) : out(o) { out.write("RTGEO1\0\0", 8); }
+    void put(int32_t v) {
+        unsigned char b[4] = { (unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16), (unsigned char)(v >> 24) };
+        out.write(reinterpret_cast<const char*>(b), 4);
+    }
+    int32_t intern(const string& s) {
+        auto [it, inserted] = ids.emplace(s, (int32_t)ids.size());
+        if (inserted) {
+            out.put(0);
+            put(it->second);
+            put((int32_t)s.size());
+            out.write(s.data(), s.size());
+        }
+        return it->second;
+    }
+    void cell(const string& path, const string& name, const string& type, int x, int y, int w, int h, int layer) override {
+        int32_t p = intern(path), n = intern(name), t = intern(type);
+        out.put(1);
+        for (int32_t v : { p, n, t, x, y, w, h, layer }) put(v);
+    }
+    void segment(const string& path, const string& net, int layer, int x1, int y1, int x2, int y2) override {
+        int32_t p = intern(path), n = intern(net);
+        out.put(2);
+        for (int32_t v : { p, n, layer, x1, y1, x2, y2 }) put(v);
+    }
+    void via(const string& path, const string& net, int x, int y) override {
+        int32_t p = intern(path), n = intern(net);
+        out.put(3);
+        for (int32_t v : { p, n, x, y }) put(v);
+    }
+    void finish() override { out.put(4); }
+};
+
+void exportGeometry(const SubModuleNode& module, const string& path, int x, int y, GeometryWriter& writer) {
+    for (const auto& comp : module.components) {
+        if (comp->pSubModuleNode) {
+            exportGeometry(*comp->pSubModuleNode, path + "/" + comp->name, x + comp->x, y + comp->y, writer);
+        }
+        else if (comp->type != "wire") {
+            writer.cell(path, comp->name, comp->type, x + comp->x, y + comp->y, comp->width, comp->height, comp->layer);
+        }
+    }
+    vector<shared_ptr<Net>> spilled;
+    if (!module.spill_path.empty()) spilled = loadSpilledNets(module);
+    for (const auto& net : module.spill_path.empty() ? module.nets : spilled) {
+        for (const auto& seg : net->segments) {
+            writer.segment(path, net->name, seg.layer, x + seg.start.x, y + seg.start.y, x + seg.end.x, y + seg.end.y);
+        }
+        for (const auto& via : net->vias) writer.via(path, net->name, x + via.x, y + via.y);
+    }
+}
+
+// 文件名以.bin结尾时写二进制，否则写JSON
+void outputGeometry(const SubModuleNode& rootModule, const string& filename) {
+    bool binary = filesystem::path(filename).extension() == ".bin";
+    ofstream outFile(filename, binary ? ios::binary : ios::out);
+    if (!outFile.is_open()) {
+        cerr << "Error opening file for writing: " << filename << endl;
+        return;
+    }
+    unique_ptr<GeometryWriter> writer;
+    if (binary) writer = make_unique<BinaryGeometryWriter>(outFile);
+    else writer = make_unique<JsonGeometryWriter>(outFile);
+    exportGeometry(rootModule, rootModule.name, 0, 0, *writer);
+    writer->finish();
+    std::cout << "导出展平几何到" << filename << endl;
+}
+
+// DEF格式（坐标以布线格点为单位）：每对相邻金属层定义一个过孔为VIAS，MOS为COMPONENTS，
+// 顶层端口为PINS，线网展平为NETS：子模块的端口线网并入父模块所连的线网，连接表列出MOS
+// 端子和顶层端口。段头的元件数、端口数、线网数需要先数一遍，因此按段各遍历一次实例树，
+// 每遍只写本段的内容，内存只与当前线网有关
+struct DefGeometryWriter : GeometryWriter {
+    enum Pass { COUNT, COMPONENTS, PINS, NETS };
+    ostream& out;
+    string top;
+    Pass pass = COUNT;
+    long long components = 0, pins = 0, nets = 0;
+    DefGeometryWriter(ostream& o, const string& t) : out(o), top(t) {}
+
+    static string layerName(int layer) { return "M" + to_string(layer + 1); }
+    // 连接layer和layer + 1的过孔
+    static string viaName(int layer) { return "VIA" + to_string(layer + 1) + "_" + to_string(layer + 2); }
+    static vector<shared_ptr<Net>> moduleNets(const SubModuleNode& module) {
+        return module.spill_path.empty() ? module.nets : loadSpilledNets(module);
+    }
+    // 去掉顶层模块名，顶层线网与同名端口对应
+    string defName(const string& path, const string& name) const {
+        return path.size() > top.size() ? path.substr(top.size() + 1) + "/" + name : name;
+    }
+    bool isPin(const string& path, const string& type) const {
+        return path == top && (type == "input" || type == "output" || type == "power");
+    }
+    bool isComponent(const string& type) const {
+        return type != "input" && type != "output" && type != "power" && type != "wire";
+    }
+    void cell(const string& path, const string& name, const string& type, int x, int y, int w, int h, int layer) override {
+        if (pass == COUNT) {
+            if (isComponent(type)) ++components;
+            else if (isPin(path, type)) ++pins;
+        }
+        else if (pass == COMPONENTS && isComponent(type)) {
+            out << "- " << defName(path, name) << " " << type << " + PLACED ( " << x << " " << y << " ) N ;\n";
+        }
+        else if (pass == PINS && isPin(path, type)) {
+            string direction = type == "input" ? "INPUT" : type == "output" ? "OUTPUT" : "INOUT";
+            string use = type != "power" ? "SIGNAL" : name == "GND" ? "GROUND" : "POWER";
+            out << "- " << name << " + NET " << name << " + DIRECTION " << direction << " + USE " << use
+                << "\n  + LAYER " << layerName(layer) << " ( 0 0 ) ( " << w << " " << h << " ) + PLACED ( "
+                << x << " " << y << " ) N ;\n";
+        }
+    }
+    // 线网不随实例树逐段送来，由writeNets按展平后的线网写出
+    void segment(const string&, const string&, int, int, int, int, int) override {}
+    void via(const string&, const string&, int, int) override {}
+    void finish() override {}
+
+    void writeVias(int layers) {
+        out << "VIAS " << layers - 1 << " ;\n";
+        for (int l = 0; l + 1 < layers; ++l) {
+            out << "- " << viaName(l) << "\n  + RECT " << layerName(l) << " ( 0 0 ) ( 1 1 )\n  + RECT CUT" << l + 1
+                << " ( 0 0 ) ( 1 1 )\n  + RECT " << layerName(l + 1) << " ( 0 0 ) ( 1 1 ) ;\n";
+        }
+        out << "END VIAS\n\n";
+    }
+
+    // 过孔所连的层：经过该点的线段和该点引脚的最低层到最高层，逐层叠放；只碰到一层时接到上一层
+    void addVias(const Net& net, Point via, int x, int y, vector<string>& routes) const {
+        int lo = INT_MAX, hi = INT_MIN;
+        for (const auto& seg : net.segments) {
+            if (via.x >= min(seg.start.x, seg.end.x) && via.x <= max(seg.start.x, seg.end.x) &&
+                via.y >= min(seg.start.y, seg.end.y) && via.y <= max(seg.start.y, seg.end.y)) {
+                lo = min(lo, seg.layer);
+                hi = max(hi, seg.layer);
+            }
+        }
+        for (const auto& pin : net.pins) {
+            if (pin->pos == via) {
+                lo = min(lo, pin->layer);
+                hi = max(hi, pin->layer);
+            }
+        }
+        if (lo > hi) lo = hi = 0;
+        if (lo == hi) {
+            if (hi + 1 < MAX_METAL_LAYER) ++hi;
+            else --lo;
+        }
+        for (int l = lo; l < hi; ++l) {
+            routes.push_back(layerName(l) + " ( " + to_string(x + via.x) + " " + to_string(y + via.y) + " ) " + viaName(l));
+        }
+    }
+
+    // 名为name的线网在module（实例路径path，偏移x, y）中的线段、过孔和所连MOS端子，
+    // 并沿连到子模块端口的连接递归并入子模块里的端口线网
+    void collectNet(const SubModuleNode& module, const vector<shared_ptr<Net>>& module_nets, const string& path,
+        int x, int y, const string& name, set<string>& conns, vector<string>& routes) const {
+        for (const auto& net : module_nets) {
+            if (net->name != name) continue;
+            for (const auto& seg : net->segments) {
+                routes.push_back(layerName(seg.layer) + " ( " + to_string(x + seg.start.x) + " " + to_string(y + seg.start.y)
+                    + " ) ( " + to_string(x + seg.end.x) + " " + to_string(y + seg.end.y) + " )");
+            }
+            for (const auto& via : net->vias) addVias(*net, via, x, y, routes);
+        }
+        set<string> targets;
+        for (auto* m : { &module.net_in_map, &module.net_out_map }) {
+            auto it = m->find(name);
+            if (it != m->end()) targets.insert(it->second.begin(), it->second.end());
+        }
+        for (const auto& target : targets) {
+            auto comp = module.comp_map.find(target);
+            if (comp != module.comp_map.end() && comp->second->pMosNode) {
+                const MosNode& mos = *comp->second->pMosNode;
+                for (const auto& [terminal, net_name] : { pair<string, string>{ "gate", mos.gate }, { "source", mos.source }, { "drain", mos.drain } }) {
+                    if (net_name == name) conns.insert("( " + defName(path, target) + " " + terminal + " )");
+                }
+                continue;
+            }
+            size_t dot = target.find('.');
+            if (dot == string::npos) continue;
+            auto inst = module.subModuleMap.find(target.substr(0, dot));
+            if (inst == module.subModuleMap.end() || !inst->second->pSubModuleNode) continue;
+            const Component& c = *inst->second;
+            collectNet(*c.pSubModuleNode, moduleNets(*c.pSubModuleNode), path + "/" + c.name, x + c.x, y + c.y,
+                target.substr(dot + 1), conns, routes);
+        }
+    }
+
+    // 线网从定义它的模块写出：顶层的全部线网和各实例内部的wire线网
+    void writeNets(const SubModuleNode& module, const string& path, int x, int y) {
+        for (const auto& comp : module.components) {
+            if (comp->pSubModuleNode) writeNets(*comp->pSubModuleNode, path + "/" + comp->name, x + comp->x, y + comp->y);
+        }
+        auto module_nets = moduleNets(module);
+        for (const auto& net : module_nets) {
+            auto port = module.comp_map.find(net->name);
+            string type = port == module.comp_map.end() ? "wire" : port->second->type;
+            if (path != top && type != "wire") continue;
+            if (pass == COUNT) {
+                ++nets;
+                continue;
+            }
+            set<string> conns;
+            vector<string> routes;
+            if (isPin(path, type)) conns.insert("( PIN " + net->name + " )");
+            collectNet(module, module_nets, path, x, y, net->name, conns, routes);
+            // 父模块和子模块在端口处可能各叠一份相同的过孔
+            unordered_set<string> seen;
+            routes.erase(remove_if(routes.begin(), routes.end(), [&](const string& r) { return !seen.insert(r).second; }), routes.end());
+            out << "- " << defName(path, net->name);
+            for (const auto& c : conns) out << "\n  " << c;
+            for (size_t i = 0; i < routes.size(); ++i) out << (i == 0 ? "\n  + ROUTED " : "\n    NEW ") << routes[i];
+            out << " ;\n";
+        }
+    }
+};
+
+void outputDef(const SubModuleNode& rootModule, const string& filename) {
+    ofstream out(filename);
+    if (!out.is_open()) {
+        cerr << "Error opening file for writing: " << filename << endl;
+        return;
+    }
+    DefGeometryWriter writer(out, rootModule.name);
+    auto run = [&](DefGeometryWriter::Pass pass) {
+        writer.pass = pass;
+        exportGeometry(rootModule, rootModule.name, 0, 0, writer);
+    };
+    run(DefGeometryWriter::COUNT);
+    writer.writeNets(rootModule, rootModule.name, 0, 0);
+    auto size = component_sizes[rootModule.module_name];
+    out << "VERSION 5.8 ;\nDIVIDERCHAR \"/\" ;\nBUSBITCHARS \"[]\" ;\n";
+    out << "DESIGN " << rootModule.name << " ;\nUNITS DISTANCE MICRONS 1 ;\n";
+    out << "DIEAREA ( 0 0 ) ( " << size.first << " " << size.second << " ) ;\n\n";
+    writer.writeVias(MAX_METAL_LAYER);
+    out << "COMPONENTS " << writer.components << " ;\n";
+    run(DefGeometryWriter::COMPONENTS);
+    out << "END COMPONENTS\n\nPINS " << writer.pins << " ;\n";
+    run(DefGeometryWriter::PINS);
+    out << "END PINS\n\nNETS " << writer.nets << " ;\n";
+    writer.pass = DefGeometryWriter::NETS;
+    writer.writeNets(rootModule, rootModule.name, 0, 0);
+    out << "END NETS\n\nEND DESIGN\n";
+    std::cout << "导出DEF到" << filename << endl;
+}
+
+// GDSII流（大端记录）：整个设计展平为一个结构，1个布线格点为1个数据库单位。
+// 元件、线段（覆盖的格点）和过孔都写成矩形BOUNDARY，层号见下
+const int GDS_CELL_LAYER = 1;     // MOS（nmos数据类型0，pmos数据类型1）
+const int GDS_PORT_LAYER = 2;     // 端口
+const int GDS_METAL_BASE = 10;    // 第l层金属写到GDS_METAL_BASE + l
+const int GDS_VIA_LAYER = 50;     // 过孔
+
+struct GdsGeometryWriter : GeometryWriter {
+    ostream& out;
+    void record(uint16_t type, const vector<uint8_t>& data = {}) {
+        uint16_t len = 4 + data.size();
+        uint8_t head[4] = { uint8_t(len >> 8), uint8_t(len), uint8_t(type >> 8), uint8_t(type) };
+        out.write(reinterpret_cast<const char*>(head), 4);
+        out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+    static void push16(vector<uint8_t>& d, int16_t v) { d.push_back(uint8_t(v >> 8)); d.push_back(uint8_t(v)); }
+    static void push32(vector<uint8_t>& d, int32_t v) { for (int s = 24; s >= 0; s -= 8) d.push_back(uint8_t(v >> s)); }
+    // GDSII的8字节实数：符号位、7位以64为偏置的16进制指数、56位尾数
+    static void pushReal(vector<uint8_t>& d, double v) {
+        uint64_t bits = 0;
+        if (v != 0) {
+            uint64_t sign = v < 0;
+            v = fabs(v);
+            int exp = 64;
+            while (v >= 1) { v /= 16; ++exp; }
+            while (v < 1.0 / 16) { v *= 16; --exp; }
+            uint64_t mant = uint64_t(llround(ldexp(v, 56)));
+            if (mant >> 56) { mant >>= 4; ++exp; }
+            bits = (sign << 63) | (uint64_t(exp) << 56) | mant;
+        }
+        for (int s = 56; s >= 0; s -= 8) d.push_back(uint8_t(bits >> s));
+    }
+    static vector<uint8_t> text(const string& s) {
+        vector<uint8_t> d(s.begin(), s.end());
+        if (d.size() & 1) d.push_back(0);
+        return d;
+    }
+    void box(int layer, int datatype, int x1, int y1, int x2, int y2) {
+        vector<uint8_t> d;
+        record(0x0800);                                  // BOUNDARY
+        push16(d, layer); record(0x0D02, d); d.clear();  // LAYER
+        push16(d, datatype); record(0x0E02, d); d.clear(); // DATATYPE
+        for (auto [x, y] : { pair<int, int>{ x1, y1 }, { x2, y1 }, { x2, y2 }, { x1, y2 }, { x1, y1 } }) {
+            push32(d, x);
+            push32(d, y);
+        }
+        record(0x1003, d);                               // XY
+        record(0x1100);                                  // ENDEL
+    }
+    GdsGeometryWriter(ostream& o, const string& top) : out(o) {
+        vector<uint8_t> d;
+        push16(d, 600); record(0x0002, d); d.clear();    // HEADER
+        for (int i = 0; i < 12; ++i) push16(d, 0);
+        record(0x0102, d);                               // BGNLIB
+        record(0x0206, text("ROUTE"));                   // LIBNAME
+        d.clear();
+        pushReal(d, 1e-3); pushReal(d, 1e-9);
+        record(0x0305, d);                               // UNITS
+        d.clear();
+        for (int i = 0; i < 12; ++i) push16(d, 0);
+        record(0x0502, d);                               // BGNSTR
+        record(0x0606, text(top));                       // STRNAME
+    }
+    void cell(const string&, const string&, const string& type, int x, int y, int w, int h, int) override {
+        if (type == "nmos" || type == "pmos") box(GDS_CELL_LAYER, type == "pmos", x, y, x + w, y + h);
+        else box(GDS_PORT_LAYER, 0, x, y, x + w, y + h);
+    }
+    void segment(const string&, const string&, int layer, int x1, int y1, int x2, int y2) override {
+        box(GDS_METAL_BASE + layer, 0, min(x1, x2), min(y1, y2), max(x1, x2) + 1, max(y1, y2) + 1);
+    }
+    void via(const string&, const string&, int x, int y) override {
+        box(GDS_VIA_LAYER, 0, x, y, x + 1, y + 1);
+    }
+    void finish() override {
+        record(0x0700);                                  // ENDSTR
+        record(0x0400);                                  // ENDLIB
+    }
+};
+
+void outputGds(const SubModuleNode& rootModule, const string& filename) {
+    ofstream out(filename, ios::binary);
+    if (!out.is_open()) {
+        cerr << "Error opening file for writing: " << filename << endl;
+        return;
+    }
+    GdsGeometryWriter writer(out, rootModule.name);
+    exportGeometry(rootModule, rootModule.name, 0, 0, writer);
+    writer.finish();
+    std::cout << "导出GDSII到" << filename << endl;
+}
+
 // 为Point定义哈希函数，用于过孔去重
 struct PointHash {
     size_t operator()(const Point& p) const {
@@ -778,50 +2541,16 @@ void routeNet(Net& net) {
     int n = points.size();
     if (n == 0) return;
 
-    // 构建完全图（曼哈顿距离）
-    std::vector<std::vector<int>> graph(n, std::vector<int>(n, 0));
-    for (int i = 0; i < n; ++i) {
-        for (int j = 0; j < n; ++j) {
-            graph[i][j] = abs(points[i].x - points[j].x) + abs(points[i].y - points[j].y);
-        }
-    }
-
-    // Prim算法构建最小生成树
-    std::vector<int> parent(n, -1);
-    std::vector<int> dist(n, INT_MAX);
-    std::vector<bool> inMST(n, false);
-
-    dist[0] = 0;
-    for (int i = 0; i < n - 1; ++i) {
-        int minDist = INT_MAX;
-        int u = -1;
-        for (int j = 0; j < n; ++j) {
-            if (!inMST[j] && dist[j] < minDist) {
-                minDist = dist[j];
-                u = j;
-            }
-        }
-        if (u == -1) break;
-        inMST[u] = true;
-
-        for (int v = 0; v < n; ++v) {
-            if (!inMST[v] && graph[u][v] < dist[v]) {
-                dist[v] = graph[u][v];
-                parent[v] = u;
-            }
-        }
-    }
+    // 斯坦纳树拓扑，树边用L形连接
+    SteinerTree tree = buildSteinerTree(points);
 
     // 过孔去重集合
     std::unordered_set<Point, PointHash> vias_set;
 
-    // 遍历最小生成树的每条边
-    for (int v = 1; v < n; ++v) {
-        int u = parent[v];
-        if (u == -1) continue;
-
-        Point A = points[u];
-        Point B = points[v];
+    // 遍历斯坦纳树的每条边
+    for (auto [u, v] : tree.edges) {
+        Point A = tree.nodes[u];
+        Point B = tree.nodes[v];
 
         // 如果两点重合，跳过
         if (A.x == B.x && A.y == B.y) continue;
@@ -868,66 +2597,867 @@ void routeNet(Net& net) {
     }
 }
 
-void rerouteConflictingNets(SubModuleNode& module);
-void reRoute(Net& net, RoutingGrid& grid);
-vector<string> builded_nets; // 用于记录已构建的nets名称
-// 递归构建nets
-void buildNets(shared_ptr<SubModuleNode> module) {
-    // 先递归处理子模块
-    for (auto& comp : module->components) {
-        if (comp->pSubModuleNode) {
-            if (find(builded_nets.begin(), builded_nets.end(), comp->type) == builded_nets.end()) buildNets(comp->pSubModuleNode);
-            for (auto& sublayer : comp->pSubModuleNode->routing_grid.metal_layers) {
-                for (int i = 0; i < sublayer.used.size(); i++) {
-                    for (int j = 0; j < sublayer.used[0].size(); j++) {
-                        if (sublayer.used[i][j]) {
-                            module->routing_grid.metal_layers[sublayer.layer_id].used[i + comp->y][j + comp->x] = true;
-                        }
-                    }
-                }
+// FNV-1a 64位哈希，跨进程稳定
+uint64_t fnv1a(const string& data, uint64_t h = 1469598103934665603ULL) {
+    for (unsigned char c : data) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// 影响布局布线结果的参数
+string layoutParamsKey() {
+    json params;
+    params["version"] = CACHE_VERSION;
+    params["sa_steps"] = SA_STEPS;
+    params["circle"] = CIRCLE;
+    params["init_temp"] = INIT_TEMP;
+    params["metal_layers"] = MAX_METAL_LAYER;
+    params["via_cost"] = VIA_COST;
+    params["astar_weight"] = ASTAR_WEIGHT;
+    params["bidir_astar"] = BIDIR_ASTAR;
+    params["track_jump"] = TRACK_JUMP;
+    params["wavefront_span"] = WAVEFRONT_SPAN;
+    params["seed"] = RANDOM_SEED;
+    params["parallel_route"] = ROUTE_THREADS > 1;
+    params["sa_batch"] = SA_BATCH;
+    params["sa_kernel"] = SA_KERNEL;
+    params["gcell"] = GCELL_SIZE;
+    params["congestion_weight"] = CONGESTION_WEIGHT;
+    params["replace_retries"] = REPLACE_RETRIES;
+    params["steiner_pins"] = STEINER_PINS;
+    params["array_place"] = ARRAY_PLACE;
+    params["multilevel_levels"] = MULTILEVEL_LEVELS;
+    params["cluster_max"] = CLUSTER_MAX;
+    params["partition_size"] = PARTITION_SIZE;
+    params["power_layers"] = POWER_LAYERS;
+    params["size_weight"] = SIZE_WEIGHT;
+    for (const auto& type : { "input", "output", "power", "wire", "nmos", "pmos" }) {
+        params["sizes"][type] = { component_sizes[type].first, component_sizes[type].second };
+    }
+    for (const auto& [type, w] : net_weights) params["weights"][type] = w;
+    return params.dump();
+}
+
+// 计算模块网表子树的内容哈希：模块自身定义 + 各子模块类型的哈希 + 参数
+string moduleContentHash(const json& all_modules, const string& module_name) {
+    static unordered_map<string, string> memo;
+    auto it = memo.find(module_name);
+    if (it != memo.end()) return it->second;
+    memo[module_name] = ""; // 防止递归引用
+    uint64_t h = fnv1a(layoutParamsKey());
+    h = fnv1a(module_name, h);
+    if (all_modules.contains(module_name)) {
+        const json& module_json = all_modules[module_name];
+        h = fnv1a(module_json.dump(), h);
+        if (module_json.contains("subModules") && module_json["subModules"].is_object()) {
+            set<string> types;
+            for (auto& [inst_name, inst_data] : module_json["subModules"].items()) {
+                types.insert(inst_data["module"].get<string>());
             }
+            for (const auto& type : types) h = fnv1a(moduleContentHash(all_modules, type), h);
         }
     }
-    // 创建当前模块的nets
-    for (auto& [net_name, idontcare] : module->comp_map)if (module->net_out_map.count(net_name) || module->net_in_map.count(net_name)) {
-        auto net = make_shared<Net>();
-        net->name = net_name;
-        string ttyyppee = module->comp_map[net_name]->type;
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+    return memo[module_name] = buf;
+}
+
+string cachePath(const SubModuleNode& module) {
+    return (filesystem::path(CACHE_DIR) / (module.content_hash + ".json")).string();
+}
+
+// 读取模块的缓存条目，不存在或损坏时返回null
+json loadCacheEntry(const SubModuleNode& module) {
+    if (CACHE_DIR.empty() || module.content_hash.empty() || replaced_modules.count(module.module_name)) return nullptr;
+    ifstream in(cachePath(module));
+    if (!in.is_open()) return nullptr;
+    json entry = json::parse(in, nullptr, false);
+    if (entry.is_discarded() || entry.value("module_name", "") != module.module_name) return nullptr;
+    return entry;
+}
+
+// 先写临时文件再改名，避免中断时留下半个条目
+void storeCacheEntry(const SubModuleNode& module, const json& entry) {
+    if (CACHE_DIR.empty() || module.content_hash.empty()) return;
+    error_code ec;
+    filesystem::create_directories(CACHE_DIR, ec);
+    string path = cachePath(module);
+    string tmp = path + ".tmp";
+    {
+        ofstream out(tmp);
+        if (!out.is_open()) {
+            cerr << "无法写入缓存: " << tmp << endl;
+            return;
+        }
+        out << entry.dump();
+    }
+    filesystem::rename(tmp, path, ec);
+    if (ec) cerr << "无法写入缓存: " << path << endl;
+}
+
+json layoutToCacheJson(const SubModuleNode& module) {
+    json entry;
+    entry["module_name"] = module.module_name;
+    entry["width"] = component_sizes[module.module_name].first;
+    entry["height"] = component_sizes[module.module_name].second;
+    json comps = json::object();
+    for (const auto& comp : module.components) {
+        comps[comp->name] = { comp->x, comp->y, comp->layer, comp->width, comp->height };
+    }
+    entry["components"] = comps;
+    return entry;
+}
+
+// 按缓存恢复元件位置；元件集合不一致时不做任何修改并返回false
+bool restoreLayoutFromCache(SubModuleNode& module, const json& entry) {
+    if (!entry.contains("components")) return false;
+    const json& comps = entry["components"];
+    if (comps.size() != module.components.size()) return false;
+    for (const auto& comp : module.components) {
+        if (!comps.contains(comp->name)) return false;
+    }
+    for (auto& comp : module.components) {
+        const json& c = comps[comp->name];
+        comp->x = c[0];
+        comp->y = c[1];
+        comp->layer = c[2];
+        comp->width = c[3];
+        comp->height = c[4];
+    }
+    component_sizes[module.module_name] = { entry["width"].get<int>(), entry["height"].get<int>() };
+    return true;
+}
+
+json netsToCacheJson(const vector<shared_ptr<Net>>& nets) {
+    json arr = json::array();
+    for (const auto& net : nets) {
+        json n;
+        n["name"] = net->name;
+        n["pins"] = json::array();
+        for (const auto& pin : net->pins) n["pins"].push_back({ pin->pos.x, pin->pos.y, pin->layer });
+        n["segments"] = json::array();
+        for (const auto& seg : net->segments) {
+            n["segments"].push_back({ seg.start.x, seg.start.y, seg.end.x, seg.end.y, seg.layer });
+        }
+        n["vias"] = json::array();
+        for (const auto& via : net->vias) n["vias"].push_back({ via.x, via.y });
+        arr.push_back(n);
+    }
+    return arr;
+}
+
+vector<shared_ptr<Net>> netsFromCacheJson(const json& arr) {
+    vector<shared_ptr<Net>> nets;
+    for (const auto& n : arr) {
+        auto net = make_shared<Net>();
+        net->name = n["name"].get<string>();
+        for (const auto& p : n["pins"]) {
+            auto pin = make_shared<Pin>();
+            pin->pos = { p[0].get<int>(), p[1].get<int>() };
+            pin->layer = p[2];
+            net->pins.push_back(pin);
+        }
+        for (const auto& sg : n["segments"]) {
+            net->segments.push_back({ { sg[0].get<int>(), sg[1].get<int>() }, { sg[2].get<int>(), sg[3].get<int>() }, sg[4].get<int>() });
+        }
+        for (const auto& v : n["vias"]) net->vias.push_back({ v[0].get<int>(), v[1].get<int>() });
+        nets.push_back(net);
+    }
+    return nets;
+}
+
+// ECO增量模式：前次布局/布线结果中每种模块类型第一个实例的节点
+struct EcoModule {
+    const json* layout = nullptr;   // Layout_after.json中的节点
+    const json* route = nullptr;    // Route_after.json中的对应节点（可能为空）
+    int off_x = 0, off_y = 0;       // 该实例的绝对偏移
+};
+json eco_layout_doc, eco_route_doc;
+unordered_map<string, EcoModule> eco_db;
+
+// 同步遍历前次的布局树与布线树，记录每种模块类型的第一个实例
+void collectEcoModules(const json& layout_node, const json* route_node) {
+    string type = layout_node.value("type", "");
+    if (!eco_db.count(type)) {
+        EcoModule m;
+        m.layout = &layout_node;
+        m.route = route_node;
+        m.off_x = layout_node["layout"]["x"];
+        m.off_y = layout_node["layout"]["y"];
+        eco_db[type] = m;
+    }
+    if (!layout_node.contains("subModules")) return;
+    for (auto& [inst, sub] : layout_node["subModules"].items()) {
+        const json* route_sub = nullptr;
+        if (route_node && route_node->contains("subModules") && (*route_node)["subModules"].contains(inst)) {
+            route_sub = &(*route_node)["subModules"][inst];
+        }
+        collectEcoModules(sub, route_sub);
+    }
+}
+
+// 元件的连接签名，签名与尺寸都不变的元件视为未修改
+string ecoSignature(const Component& comp) {
+    string sig = comp.type;
+    if (comp.pMosNode) {
+        sig += "|" + comp.pMosNode->gate + "|" + comp.pMosNode->source + "|" + comp.pMosNode->drain;
+    }
+    else if (!comp.pSubModuleNode) {
+        for (const auto& n : comp.in) sig += "|<" + n;
+        for (const auto& n : comp.out) sig += "|>" + n;
+    }
+    return sig + "#" + to_string(comp.width) + "x" + to_string(comp.height);
+}
+
+string ecoSignature(const string& group, const json& node) {
+    const json& l = node["layout"];
+    string sig = node["type"].get<string>();
+    if (group == "mosfets") {
+        sig += "|" + node["gate"].get<string>() + "|" + node["source"].get<string>() + "|" + node["drain"].get<string>();
+    }
+    else if (group == "ports") {
+        if (node.contains("in")) for (const auto& n : node["in"]) sig += "|<" + n.get<string>();
+        if (node.contains("out")) for (const auto& n : node["out"]) sig += "|>" + n.get<string>();
+    }
+    return sig + "#" + to_string(l["width"].get<int>()) + "x" + to_string(l["height"].get<int>());
+}
+
+// 在desired附近由近及远寻找不与其他元件重叠的位置
+void ecoFindFreeSpot(shared_ptr<Component> comp, int want_x, int want_y,
+    const vector<shared_ptr<Component>>& placed) {
+    int reach = 0;
+    for (const auto& other : placed) reach = max(reach, max(abs(other->x - want_x), abs(other->y - want_y)) + other->width + other->height);
+    for (int r = 0; r <= reach + 1; ++r) {
+        for (int dy = -r; dy <= r; ++dy) {
+            for (int dx = -r; dx <= r; ++dx) {
+                if (max(abs(dx), abs(dy)) != r) continue;
+                comp->x = want_x + dx;
+                comp->y = want_y + dy;
+                bool overlap = false;
+                for (const auto& other : placed) {
+                    if (other != comp && comp->overlaps(other)) {
+                        overlap = true;
+                        break;
+                    }
+                }
+                if (!overlap) return;
+            }
+        }
+    }
+}
+
+// ECO增量布局：保留未修改元件的前次位置，只对修改或新增的元件做低温局部退火。
+// 没有前次结果时返回false
+bool ecoLayout(shared_ptr<SubModuleNode> Module, int width_bound, int height_bound) {
+    auto it = eco_db.find(Module->module_name);
+    if (it == eco_db.end()) return false;
+    const EcoModule& prev = it->second;
+    const json& node = *prev.layout;
+
+    // 前次各元件的签名与相对坐标
+    unordered_map<string, pair<string, const json*>> prev_comps;
+    for (const auto& group : { "ports", "mosfets", "subModules" }) {
+        if (!node.contains(group)) continue;
+        for (auto& [name, c] : node[group].items()) prev_comps[name] = { ecoSignature(group, c), &c };
+    }
+
+    vector<shared_ptr<Component>> changed, placed;
+    bool port_changed = false;
+    Module->eco_anchor = nullptr;
+    Module->eco_kept.clear();
+    for (auto& comp : Module->components) {
+        comp->fixed = false;
+        auto pc = prev_comps.find(comp->name);
+        if (pc != prev_comps.end()) {
+            const json& l = (*pc->second.second)["layout"];
+            comp->x = l["x"].get<int>() - prev.off_x;
+            comp->y = l["y"].get<int>() - prev.off_y;
+            comp->layer = l["layer"];
+        }
+        if (comp->type == "wire") {
+            if (pc == prev_comps.end()) comp->x = comp->y = -10000;
+            continue;
+        }
+        bool is_port = comp->type == "input" || comp->type == "output" || comp->type == "power";
+        if (pc != prev_comps.end() && pc->second.first == ecoSignature(*comp)) {
+            comp->fixed = true;
+            placed.push_back(comp);
+            if (!is_port) {
+                Module->eco_kept.insert(comp->name);
+                if (!Module->eco_anchor) {
+                    Module->eco_anchor = comp;
+                    Module->eco_anchor_pos = { comp->x, comp->y };
+                }
+            }
+        }
+        else if (is_port) {
+            port_changed = true;
+        }
+        else {
+            if (pc == prev_comps.end()) comp->x = comp->y = INT_MIN;
+            changed.push_back(comp);
+        }
+    }
+    size_t prev_count = 0;
+    for (auto& [name, pc] : prev_comps) if ((*pc.second)["type"] != "wire") prev_count++;
+    Module->eco = true;
+    if (changed.empty() && !port_changed && placed.size() == prev_count) {
+        for (auto& comp : Module->components) comp->fixed = false;
+        cout << "ECO：模块" + Module->module_name + "未修改，沿用前次布局" << endl;
+        return true;
+    }
+
+    // 新元件的期望位置取与之相连的已放置元件的重心
+    for (auto& comp : changed) {
+        if (comp->x == INT_MIN) {
+            long long sx = 0, sy = 0, cnt = 0;
+            for (auto* names : { &comp->in, &comp->out }) {
+                for (const auto& net : *names) {
+                    vector<shared_ptr<Component>> peers;
+                    if (Module->comp_map.count(net)) peers.push_back(Module->comp_map[net]);
+                    for (auto* m : { &Module->in_map, &Module->out_map }) {
+                        auto pit = m->find(net);
+                        if (pit != m->end()) peers.insert(peers.end(), pit->second.begin(), pit->second.end());
+                    }
+                    for (const auto& peer : peers) {
+                        if (!peer->fixed || peer->type == "wire") continue;
+                        sx += peer->x;
+                        sy += peer->y;
+                        cnt++;
+                    }
+                }
+            }
+            comp->x = cnt ? sx / cnt : 0;
+            comp->y = cnt ? sy / cnt : 0;
+        }
+        ecoFindFreeSpot(comp, comp->x, comp->y, placed);
+        placed.push_back(comp);
+    }
+    cout << "ECO：模块" + Module->module_name + "保留" << Module->components.size() - changed.size()
+        << "个元件，重新布局" << changed.size() << "个" << endl;
+
+    // 低温局部退火，只移动修改过的元件
+    if (!changed.empty()) {
+        simulated_annealing(Module->components, Module->in_map, Module->out_map,
+            width_bound, height_bound, INIT_TEMP * ECO_TEMP_RATIO);
+    }
+    for (auto& comp : Module->components) comp->fixed = false;
+    arrangePorts(Module->components);
+    return true;
+}
+
+// ECO增量布线：引脚与前次完全一致且不与子模块占用冲突的线网沿用前次布线，并固定不动。
+// 返回需要重新布线的线网数
+int ecoRestoreNets(SubModuleNode& module) {
+    auto it = eco_db.find(module.module_name);
+    if (!module.eco || !module.eco_anchor || it == eco_db.end() || !it->second.route) return module.nets.size();
+    const EcoModule& prev = it->second;
+    const json& route = *prev.route;
+    if (!route.contains("nets")) return module.nets.size();
+    int dx = module.eco_anchor->x - module.eco_anchor_pos.x - prev.off_x;
+    int dy = module.eco_anchor->y - module.eco_anchor_pos.y - prev.off_y;
+    unordered_map<string, const json*> prev_nets;
+    for (const auto& n : route["nets"]) prev_nets[n["name"].get<string>()] = &n;
+
+    RoutingGrid& grid = module.routing_grid;
+    auto inside = [&](int x, int y) { return x >= 0 && x < grid.width && y >= 0 && y < grid.height; };
+    int rerouted = 0;
+    for (auto& net : module.nets) {
+        auto pn = prev_nets.find(net->name);
+        bool keep = pn != prev_nets.end();
+        if (keep) {
+            const json& n = *pn->second;
+            vector<tuple<int, int, int>> a, b;
+            for (const auto& pin : net->pins) a.push_back({ pin->pos.x, pin->pos.y, pin->layer });
+            if (n.contains("pins")) for (const auto& p : n["pins"]) b.push_back({ p["x"].get<int>() + dx, p["y"].get<int>() + dy, p["layer"].get<int>() });
+            sort(a.begin(), a.end());
+            sort(b.begin(), b.end());
+            keep = a == b;
+        }
+        Net restored;
+        unordered_set<Point, PointHash> pin_cells;
+        for (const auto& pin : net->pins) pin_cells.insert(pin->pos);
+        if (keep) {
+            const json& n = *pn->second;
+            if (n.contains("segments")) for (const auto& sg : n["segments"]) {
+                Segment seg = { { sg["start"]["x"].get<int>() + dx, sg["start"]["y"].get<int>() + dy },
+                    { sg["end"]["x"].get<int>() + dx, sg["end"]["y"].get<int>() + dy }, sg["layer"].get<int>() };
+                if (!inside(seg.start.x, seg.start.y) || !inside(seg.end.x, seg.end.y) || seg.layer >= (int)grid.metal_layers.size()) {
+                    keep = false;
+                    break;
+                }
+                // 除引脚外不能压在子模块的布线上
+                for (int y = min(seg.start.y, seg.end.y); keep && y <= max(seg.start.y, seg.end.y); ++y)
+                    for (int x = min(seg.start.x, seg.end.x); keep && x <= max(seg.start.x, seg.end.x); ++x)
+                        if (!grid.isPositionFree(seg.layer, { x, y }) && !pin_cells.count({ x, y })) keep = false;
+                restored.segments.push_back(seg);
+            }
+            if (keep && n.contains("vias")) for (const auto& v : n["vias"]) {
+                Point via = { v["x"].get<int>() + dx, v["y"].get<int>() + dy };
+                if (!inside(via.x, via.y)) {
+                    keep = false;
+                    break;
+                }
+                restored.vias.push_back(via);
+            }
+        }
+        if (keep) {
+            net->segments = move(restored.segments);
+            net->vias = move(restored.vias);
+            net->fixed = true;
+        }
+        else {
+            rerouted++;
+        }
+    }
+    for (auto& net : module.nets) {
+        if (net->fixed) markNetOnGrid(*net, grid);
+    }
+    cout << "ECO：模块" + module.module_name + "保留" << module.nets.size() - rerouted << "条线网，重新布线" << rerouted << "条" << endl;
+
+    // 检查：只连接保留元件的内部线网应沿用前次布线，否则说明平移量有误或前次布线被新元件压住
+    auto kept_end = [&](const string& end) { return module.eco_kept.count(end.substr(0, end.find('.'))) > 0; };
+    int lost = 0;
+    for (const auto& net : module.nets) {
+        if (net->fixed || !module.comp_map.count(net->name) || module.comp_map[net->name]->type != "wire") continue;
+        bool internal = true;
+        for (auto* m : { &module.net_in_map, &module.net_out_map }) {
+            auto nit = m->find(net->name);
+            if (nit == m->end()) continue;
+            for (const auto& end : nit->second) internal = internal && kept_end(end);
+        }
+        if (internal) lost++;
+    }
+    if (lost > 0) cout << "ECO：模块" + module.module_name + "有" << lost << "条只连接保留元件的线网未能沿用前次布线" << endl;
+    return rerouted;
+}
+
+// 布线搜索统计
+struct RouteStats {
+    atomic<long long> searches{ 0 }; // A*搜索次数
+    atomic<long long> expanded{ 0 }; // 扩展节点数
+    atomic<long long> pushed{ 0 };   // 入堆节点数
+    atomic<long long> waves{ 0 };    // 按位波前搜索找到路径的次数
+};
+RouteStats route_stats;
+
+// 引脚接入点：相对元件左下角的局部坐标及所在层
+struct PinAccess {
+    int dx = 0, dy = 0;
+    int layer = 0;
+};
+
+// 引脚接入库：元件类型 -> 端子名 -> 接入点。每种类型布局确定后只建立一次，
+// 实例的引脚由接入点平移得到
+unordered_map<string, unordered_map<string, PinAccess>> pin_access_db;
+
+// 取元件类型的接入表，首次使用时建立
+const unordered_map<string, PinAccess>& pinAccessTable(const Component& comp) {
+    auto it = pin_access_db.find(comp.type);
+    if (it != pin_access_db.end()) return it->second;
+    auto& table = pin_access_db[comp.type];
+    if (comp.pSubModuleNode) {
+        // 子模块：各端口元件的中心，层为子模块内部的层
+        for (const auto& port : comp.pSubModuleNode->components) {
+            if (port->pSubModuleNode || port->pMosNode) continue;
+            table[port->name] = { port->x + port->width / 2, port->y + port->height / 2, port->layer };
+        }
+    }
+    else if (comp.pMosNode) {
+        // MOS：栅极在上部中间，源极在左侧，漏极在右侧
+        table["gate"] = { comp.width / 2, comp.height * 3 / 4, 0 };
+        table["source"] = { comp.width / 4, comp.height / 2, 0 };
+        table["drain"] = { comp.width - 1, comp.height / 2, 0 };
+    }
+    else {
+        // 端口元件：自身中心；电源线接在上下边
+        table[""] = { comp.width / 2, comp.height / 2, 0 };
+        table["VCC"] = { comp.width / 4, comp.height - 1, 0 };
+        table["GND"] = { comp.width / 4, comp.height, 0 };
+    }
+    return table;
+}
+
+// 接入点平移到实例位置；子模块内部各层自成体系，端口层不随实例所在层变化
+Pin instancePin(const Component& comp, const PinAccess& access) {
+    Pin pin;
+    pin.pos = { comp.x + access.dx, comp.y + access.dy };
+    pin.layer = (comp.pSubModuleNode ? 0 : comp.layer) + access.layer;
+    return pin;
+}
+
+bool rerouteConflictingNets(SubModuleNode& module);
+bool checkNetOverlap(Net& net1, Net& net2);
+struct RouteCostModel;
+extern RouteCostModel route_cost;
+void reRoute(Net& net, RoutingGrid& grid, const RouteCostModel& cost = route_cost);
+unordered_set<string> builded_nets; // 用于记录已构建nets的模块类型
+
+// 模块布线完成后的各层占用，同类型的所有实例共享同一份只读数据
+void buildOccupancyTile(SubModuleNode& module) {
+    auto tile = make_shared<vector<BitGrid>>();
+    for (const auto& layer : module.routing_grid.metal_layers) tile->push_back(layer.used);
+    module.occupancy_tile = tile;
+}
+
+// 全局布线：把布线网按GCELL_SIZE分成粗格，在粗格图上为每个线网找一棵连通树，
+// 边代价随拥挤度上升，溢出的边多轮拆线重布并累积历史代价。树所覆盖的粗格
+// 向外扩一圈作为该线网的走廊，详细布线只在走廊内搜索
+struct GlobalRouter {
+    int gw = 0, gh = 0;
+    vector<int> cap_h, cap_v;       // 粗格右边/上边的容量（可用轨道数）
+    vector<int> use_h, use_v;       // 已占用
+    vector<double> hist_h, hist_v;  // 历史拥挤代价
+
+    void build(const RoutingGrid& grid) {
+        gw = (grid.width + GCELL_SIZE - 1) / GCELL_SIZE;
+        gh = (grid.height + GCELL_SIZE - 1) / GCELL_SIZE;
+        vector<int> free_h(gw * gh, 0), free_v(gw * gh, 0);
+        for (int l = 0; l < grid.signal_layers; ++l) {
+            const auto& layer = grid.metal_layers[l];
+            auto& free_cells = layer.is_horizontal ? free_h : free_v;
+            for (int y = 0; y < grid.height; ++y) {
+                for (int x = 0; x < grid.width; ++x) {
+                    if (!layer.used.get(x, y)) free_cells[(y / GCELL_SIZE) * gw + x / GCELL_SIZE]++;
+                }
+            }
+        }
+        // 一条轨道穿过粗格需要GCELL_SIZE个空格点
+        cap_h.assign(gw * gh, 0);
+        cap_v.assign(gw * gh, 0);
+        for (int i = 0; i < gw * gh; ++i) {
+            cap_h[i] = free_h[i] / GCELL_SIZE;
+            cap_v[i] = free_v[i] / GCELL_SIZE;
+        }
+        use_h.assign(gw * gh, 0);
+        use_v.assign(gw * gh, 0);
+        hist_h.assign(gw * gh, 0);
+        hist_v.assign(gw * gh, 0);
+    }
+
+    // 边编号：2*粗格 + 方向(0向右, 1向上)
+    int& use(int e) { return (e & 1) ? use_v[e >> 1] : use_h[e >> 1]; }
+    int capacity(int e) const {
+        int a = e >> 1;
+        int b = a + ((e & 1) ? gw : 1);
+        return (e & 1) ? min(cap_v[a], cap_v[b]) : min(cap_h[a], cap_h[b]);
+    }
+    double edgeCost(int e) {
+        double hist = (e & 1) ? hist_v[e >> 1] : hist_h[e >> 1];
+        int over = use(e) + 1 - capacity(e);
+        return 1.0 + hist + (over > 0 ? 4.0 * over : 0.0);
+    }
+    int overflow(int e) {
+        int a = e >> 1;
+        bool valid = (e & 1) ? a / gw + 1 < gh : a % gw + 1 < gw; // 边界外没有边
+        return valid ? max(0, use(e) - capacity(e)) : 0;
+    }
+
+    // 从已连通的粗格出发做Dijkstra，依次接上其余引脚所在粗格，返回用到的边
+    vector<int> routeNet(const vector<int>& pin_cells) {
+        vector<int> edges;
+        if (pin_cells.empty()) return edges;
+        vector<char> in_tree(gw * gh, 0), is_pin(gw * gh, 0);
+        in_tree[pin_cells[0]] = 1;
+        int remaining = 0;
+        for (int c : pin_cells) {
+            if (!in_tree[c] && !is_pin[c]) remaining++;
+            is_pin[c] = 1;
+        }
+        vector<double> dist(gw * gh);
+        vector<int> from(gw * gh);
+        while (remaining > 0) {
+            fill(dist.begin(), dist.end(), 1e18);
+            priority_queue<pair<double, int>, vector<pair<double, int>>, greater<pair<double, int>>> pq;
+            for (int c = 0; c < gw * gh; ++c) {
+                if (in_tree[c]) { dist[c] = 0; from[c] = -1; pq.push({ 0, c }); }
+            }
+            int reached = -1;
+            while (!pq.empty()) {
+                auto [d, c] = pq.top();
+                pq.pop();
+                if (d > dist[c]) continue;
+                if (is_pin[c] && !in_tree[c]) { reached = c; break; }
+                int cx = c % gw, cy = c / gw;
+                // 四个方向：边编号与对端粗格
+                int nbr[4][2] = {
+                    { cx + 1 < gw ? 2 * c : -1, c + 1 },
+                    { cx > 0 ? 2 * (c - 1) : -1, c - 1 },
+                    { cy + 1 < gh ? 2 * c + 1 : -1, c + gw },
+                    { cy > 0 ? 2 * (c - gw) + 1 : -1, c - gw },
+                };
+                for (auto& [e, n] : nbr) {
+                    if (e < 0) continue;
+                    double nd = d + edgeCost(e);
+                    if (nd < dist[n]) { dist[n] = nd; from[n] = e; pq.push({ nd, n }); }
+                }
+            }
+            if (reached < 0) break; // 粗格图不连通（不应发生）
+            for (int c = reached; !in_tree[c]; ) {
+                in_tree[c] = 1;
+                int e = from[c];
+                edges.push_back(e);
+                use(e)++;
+                int a = e >> 1, b = a + ((e & 1) ? gw : 1);
+                c = (c == b) ? a : b;
+            }
+            remaining--;
+        }
+        return edges;
+    }
+
+    void ripUp(const vector<int>& edges) {
+        for (int e : edges) use(e)--;
+    }
+
+    // 树覆盖的粗格外扩一圈
+    shared_ptr<GCellCorridor> corridor(const vector<int>& pin_cells, const vector<int>& edges) const {
+        auto c = make_shared<GCellCorridor>();
+        c->size = GCELL_SIZE;
+        c->gw = gw;
+        c->gh = gh;
+        c->mask.assign(gw * gh, 0);
+        c->tree_edges = edges;
+        for (int cell : pin_cells) c->markAround(cell);
+        for (int e : edges) {
+            c->markAround(e >> 1);
+            c->markAround((e >> 1) + ((e & 1) ? gw : 1));
+        }
+        return c;
+    }
+};
+
+// 为模块的非固定线网分配走廊，返回总溢出（给布局的拥挤反馈）
+int globalRoute(SubModuleNode& module) {
+    RoutingGrid& grid = module.routing_grid;
+    if (grid.width <= 0 || grid.height <= 0) return 0;
+    GlobalRouter gr;
+    gr.build(grid);
+    auto& nets = module.nets;
+    vector<vector<int>> pin_cells(nets.size()), tree(nets.size());
+    for (size_t i = 0; i < nets.size(); ++i) {
+        for (const auto& pin : nets[i]->pins) {
+            if (!grid.inBounds(pin->pos)) continue;
+            pin_cells[i].push_back((pin->pos.y / GCELL_SIZE) * gr.gw + pin->pos.x / GCELL_SIZE);
+        }
+    }
+    for (size_t i = 0; i < nets.size(); ++i) {
+        if (!nets[i]->fixed) tree[i] = gr.routeNet(pin_cells[i]);
+    }
+    // 拆掉经过溢出边的线网，加重历史代价后重布
+    int total_overflow = 0;
+    for (int pass = 0; pass < 3; ++pass) {
+        total_overflow = 0;
+        for (int e = 0; e < 2 * gr.gw * gr.gh; ++e) {
+            int over = gr.overflow(e);
+            if (over == 0) continue;
+            total_overflow += over;
+            ((e & 1) ? gr.hist_v[e >> 1] : gr.hist_h[e >> 1]) += 1.0;
+        }
+        if (total_overflow == 0) break;
+        for (size_t i = 0; i < nets.size(); ++i) {
+            bool congested = false;
+            for (int e : tree[i]) congested = congested || gr.overflow(e) > 0;
+            if (!congested) continue;
+            gr.ripUp(tree[i]);
+            tree[i] = gr.routeNet(pin_cells[i]);
+        }
+    }
+    total_overflow = 0;
+    for (int e = 0; e < 2 * gr.gw * gr.gh; ++e) total_overflow += gr.overflow(e);
+    for (size_t i = 0; i < nets.size(); ++i) {
+        if (!nets[i]->fixed) nets[i]->corridor = gr.corridor(pin_cells[i], tree[i]);
+    }
+    cout << "全局布线" << module.module_name << "：" << gr.gw << "x" << gr.gh << "个粗格，溢出" << total_overflow << endl;
+    return total_overflow;
+}
+
+// 电源/时钟网络：power类型端口（VCC、GND、CLK）的线网不进迷宫布线，直接在顶部
+// POWER_LAYERS层上生成。电源是一根竖直干线加各引脚所在行的水平轨，放不下时和
+// 时钟一样沿斯坦纳树走L形；引脚处用过孔叠到轨道层。生成的线网固定不动，信号线只用下面的层。
+// 在水平层h、竖直层v上为线网生成几何写入trial，与已有占用冲突时返回false
+bool powerGeometry(const Net& net, RoutingGrid& grid, int h, int v, Net& trial) {
+    // 引脚处的占用属于同一线网（子模块的同名端口）
+    unordered_set<Point, PointHash> pin_cells;
+    for (const auto& pin : net.pins) pin_cells.insert(pin->pos);
+    auto segmentFree = [&](const Segment& seg) {
+        for (int y = min(seg.start.y, seg.end.y); y <= max(seg.start.y, seg.end.y); ++y)
+            for (int x = min(seg.start.x, seg.end.x); x <= max(seg.start.x, seg.end.x); ++x)
+                if (!grid.inBounds({ x, y }) || (!pin_cells.count({ x, y }) && !grid.isPositionFree(seg.layer, { x, y }))) return false;
+        return true;
+    };
+    auto viaFree = [&](Point p) { return grid.inBounds(p) && (pin_cells.count(p) || grid.isViaFree(p)); };
+    auto addVia = [&](Point p) {
+        if (find(trial.vias.begin(), trial.vias.end(), p) == trial.vias.end()) trial.vias.push_back(p);
+    };
+    trial.segments.clear();
+    trial.vias.clear();
+    for (const auto& pin : net.pins) addVia(pin->pos);
+
+    if (net.name == "VCC" || net.name == "GND") {
+        int lo_x = INT_MAX, hi_x = INT_MIN, lo_y = INT_MAX, hi_y = INT_MIN;
+        map<int, pair<int, int>> rows; // 行 -> 该行引脚的横向范围
+        vector<int> xs;
+        for (const auto& pin : net.pins) {
+            Point p = pin->pos;
+            lo_x = min(lo_x, p.x); hi_x = max(hi_x, p.x);
+            lo_y = min(lo_y, p.y); hi_y = max(hi_y, p.y);
+            auto it = rows.find(p.y);
+            if (it == rows.end()) rows[p.y] = { p.x, p.x };
+            else it->second = { min(it->second.first, p.x), max(it->second.second, p.x) };
+            xs.push_back(p.x);
+        }
+        // 干线从引脚横坐标的中位数开始向两边找第一个放得下的位置
+        nth_element(xs.begin(), xs.begin() + xs.size() / 2, xs.end());
+        int mid = xs[xs.size() / 2];
+        for (int d = 0; d <= max(mid - lo_x, hi_x - mid); ++d) {
+            for (int k = 0; k < (d == 0 ? 1 : 2); ++k) {
+                int x = k == 0 ? mid - d : mid + d;
+                if (x < lo_x || x > hi_x) continue;
+                trial.segments.clear();
+                if (lo_y < hi_y) trial.segments.push_back({ { x, lo_y }, { x, hi_y }, v });
+                bool ok = true;
+                for (const auto& [y, range] : rows) {
+                    int a = lo_y < hi_y ? min(range.first, x) : range.first;
+                    int b = lo_y < hi_y ? max(range.second, x) : range.second;
+                    if (a < b) trial.segments.push_back({ { a, y }, { b, y }, h });
+                    if (lo_y < hi_y && !viaFree({ x, y })) ok = false;
+                }
+                for (const auto& seg : trial.segments) ok = ok && segmentFree(seg);
+                if (!ok) continue;
+                if (lo_y < hi_y) {
+                    for (const auto& [y, range] : rows) addVia({ x, y });
+                }
+                return true;
+            }
+        }
+        // 放不下干线时和时钟一样走斯坦纳树
+        trial.segments.clear();
+    }
+
+    vector<Point> points;
+    for (const auto& pin : net.pins) points.push_back(pin->pos);
+    SteinerTree tree = buildSteinerTree(points);
+    vector<vector<int>> children(tree.nodes.size());
+    for (auto [a, b] : tree.edges) children[a].push_back(b);
+    vector<pair<int, int>> queue;
+    for (int b : children[0]) queue.push_back({ 0, b });
+    for (size_t i = 0; i < queue.size(); ++i) {
+        auto [a, b] = queue[i];
+        Point A = tree.nodes[a], B = tree.nodes[b];
+        // 候选折线：两种L形，再试中段偏开的Z形/U形绕过障碍
+        vector<vector<Point>> candidates = { { A, { B.x, A.y }, B }, { A, { A.x, B.y }, B } };
+        for (int d = 0; d <= POWER_DETOUR; ++d) {
+            for (int sign : { 1, -1 }) {
+                if (d == 0 && sign < 0) continue;
+                int ym = (A.y + B.y) / 2 + sign * d, xm = (A.x + B.x) / 2 + sign * d;
+                candidates.push_back({ A, { A.x, ym }, { B.x, ym }, B });
+                candidates.push_back({ A, { xm, A.y }, { xm, B.y }, B });
+            }
+        }
+        bool placed = false;
+        for (const auto& poly : candidates) {
+            vector<Segment> legs;
+            for (size_t k = 1; k < poly.size(); ++k) {
+                if (!(poly[k - 1] == poly[k])) legs.push_back({ poly[k - 1], poly[k], poly[k - 1].y == poly[k].y ? h : v });
+            }
+            bool ok = true;
+            for (const auto& seg : legs) ok = ok && segmentFree(seg);
+            for (Point p : poly) ok = ok && viaFree(p);
+            if (!ok) continue;
+            trial.segments.insert(trial.segments.end(), legs.begin(), legs.end());
+            for (Point p : poly) addVia(p);
+            placed = true;
+            break;
+        }
+        // 放不下的斯坦纳点跳过，其子节点改从父节点连接
+        if (!placed && b < tree.pin_count) return false;
+        for (int c : children[b]) queue.push_back({ placed ? b : a, c });
+    }
+    return true;
+}
+
+// 为模块的电源/时钟线网生成轨道，返回生成的线网数；放不下的线网留给迷宫布线
+int synthesizePowerNets(SubModuleNode& module) {
+    RoutingGrid& grid = module.routing_grid;
+    int top = grid.metal_layers.size();
+    int built = 0, left = 0;
+    for (auto& net : module.nets) {
+        auto port = module.comp_map.find(net->name);
+        if (net->fixed || net->pins.size() < 2 || port == module.comp_map.end() || port->second->type != "power") continue;
+        Net trial;
+        bool ok = false;
+        int low = top;
+        // 从最顶上的一对层往下试
+        for (int l = top - 2; l >= grid.signal_layers && !ok; l -= 2) {
+            int h = grid.metal_layers[l].is_horizontal ? l : l + 1;
+            ok = powerGeometry(*net, grid, h, l + l + 1 - h, trial);
+            low = l;
+        }
+        if (!ok) {
+            left++;
+            continue;
+        }
+        net->segments = move(trial.segments);
+        net->vias = move(trial.vias);
+        net->fixed = true;
+        markNetOnGrid(*net, grid);
+        // 引脚所在层到轨道层之间的过孔叠层
+        for (const auto& pin : net->pins) {
+            for (int l = pin->layer; l < low; ++l) grid.setUsed(l, pin->pos, true);
+        }
+        built++;
+    }
+    if (built + left > 0) {
+        cout << "电源网络" << module.module_name << "：生成" << built << "条，交给迷宫布线" << left << "条" << endl;
+    }
+    return built;
+}
+
+// 递归构建nets
+// 按网表和引脚接入库创建模块的nets，并在布线网上保留引脚接入点
+void createModuleNets(SubModuleNode& module) {
+    // 端点先解析为(元件, 端子)，引脚由接入库平移得到
+    auto addPin = [&](Net& net, const Component& comp, const string& terminal) {
+        const auto& table = pinAccessTable(comp);
+        auto it = table.find(terminal);
+        if (it == table.end()) return false;
+        net.pins.push_back(make_shared<Pin>(instancePin(comp, it->second)));
+        return true;
+    };
+    // MOS端子按线网名匹配栅、源、漏，网表的in/out不一定对应漏/源，匹配不到时才用fallback
+    auto mosTerminal = [](const MosNode& mos, const string& net_name, const string& fallback) -> string {
+        if (mos.gate == net_name) return "gate";
+        if (mos.source == net_name) return "source";
+        if (mos.drain == net_name) return "drain";
+        return fallback;
+    };
+    for (auto& [net_name, idontcare] : module.comp_map)if (module.net_out_map.count(net_name) || module.net_in_map.count(net_name)) {
+        auto net = make_shared<Net>();
+        net->name = net_name;
+        const Component& net_comp = *module.comp_map[net_name];
+        string ttyyppee = net_comp.type;
         if (ttyyppee == "input" || ttyyppee == "output" || ttyyppee == "power") {
-            auto selfpin = make_shared<Pin>();
-            selfpin->pos = { module->comp_map[net_name]->x + module->comp_map[net_name]->width / 2, module->comp_map[net_name]->y + module->comp_map[net_name]->height / 2 };
-            selfpin->layer = module->comp_map[net_name]->layer;
-            net->pins.push_back(selfpin);
-            module->routing_grid.via_space[selfpin->pos.y][selfpin->pos.x] = true; // 标记过孔位置
-        }
-        if (module->net_out_map.count(net_name)) {
-            auto targets = module->net_out_map[net_name];
+            addPin(*net, net_comp, "");
+        }
+        if (module.net_out_map.count(net_name)) {
+            const auto& targets = module.net_out_map[net_name];
             if (ttyyppee != "input" && ttyyppee != "output" && ttyyppee != "wire" && ttyyppee != "power") continue;
             for (auto& target : targets) {  // 例如：target = o2
-                if (module->comp_map.count(target)) {
-                    auto target_comp = module->comp_map[target];
-                    auto pin = make_shared<Pin>();
-                    if (target_comp->type == "nmos" || target_comp->type == "pmos") {
-                        if (target_comp->pMosNode->gate == net_name) {
-                            pin->pos = { target_comp->x + target_comp->width / 2, target_comp->y + target_comp->height * 3 / 4 };
-                            pin->layer = target_comp->layer;
-                        }
-                        else {
-                            pin->pos = { target_comp->x + target_comp->width / 4, target_comp->y + target_comp->height / 2 };
-                            pin->layer = target_comp->layer;
-
-                        }
+                auto target_it = module.comp_map.find(target);
+                if (target_it != module.comp_map.end()) {
+                    const Component& target_comp = *target_it->second;
+                    if (target_comp.pMosNode) {
+                        addPin(*net, target_comp, mosTerminal(*target_comp.pMosNode, net_name, "source"));
                     }
                     else if (net->name == "VCC" || net->name == "GND") {
-                        int isvcc = (net->name == "VCC") ? 1 : 0;
-                        pin->layer = target_comp->layer;
-                        pin->pos = { target_comp->x + target_comp->width / 4, target_comp->y + target_comp->height - isvcc };
+                        addPin(*net, target_comp, net->name);
                     }
                     else {
                         cout << "不认识：" << ttyyppee << "类型的" << net_name << "的输出引脚" << target << endl;
                     }
-                    net->pins.push_back(pin);
-                    module->routing_grid.via_space[pin->pos.y][pin->pos.x] = true; // 标记过孔位置
                 }
                 else {
                     size_t dotpos = target.find('.');
@@ -937,28 +3467,9 @@ void buildNets(shared_ptr<SubModuleNode> module) {
                     else {
                         string submod_name = target.substr(0, dotpos);
                         string input_name = target.substr(dotpos + 1);
-                        if (module->subModuleMap.count(submod_name)) {
-                            int offsetx = module->comp_map[submod_name]->x;
-                            int offsety = module->comp_map[submod_name]->y;
-                            if (input_name == "VCC" || input_name == "GND") {
-                                auto pin = make_shared<Pin>();
-                                auto fuck = module->comp_map[submod_name]->pSubModuleNode->comp_map[input_name];
-                                pin->pos = { offsetx + fuck->x + fuck->width / 2 , offsety + fuck->y + fuck->width / 2 };
-                                pin->layer = fuck->layer;
-                                net->pins.push_back(pin);
-                                module->routing_grid.via_space[pin->pos.y][pin->pos.x] = true; // 标记过孔位置
-                            }
-                            else {
-                                auto submod = module->subModuleMap[submod_name]->pSubModuleNode;
-                                if (submod->comp_map.count(input_name)) {
-                                    auto input_comp = submod->comp_map[input_name];
-                                    auto pin = make_shared<Pin>();
-                                    pin->pos = { offsetx + input_comp->x + input_comp->width / 2, offsety + input_comp->y + input_comp->height / 2 };
-                                    pin->layer = input_comp->layer;
-                                    net->pins.push_back(pin);
-                                    module->routing_grid.via_space[pin->pos.y][pin->pos.x] = true; // 标记过孔位置
-                                }
-                            }
+                        auto inst_it = module.subModuleMap.find(submod_name);
+                        if (inst_it != module.subModuleMap.end()) {
+                            addPin(*net, *inst_it->second, input_name);
                         }
                         else {
                             cout << "布线时对于网络" + net_name + "的输出端口" + target + "未找到子模块" + submod_name << endl;
@@ -967,24 +3478,21 @@ void buildNets(shared_ptr<SubModuleNode> module) {
                 }
             }
         }
-        if (module->net_in_map.count(net_name)) {
-            auto sources = module->net_in_map[net_name];
+        if (module.net_in_map.count(net_name)) {
+            const auto& sources = module.net_in_map[net_name];
             if (ttyyppee != "input" && ttyyppee != "output" && ttyyppee != "wire" && ttyyppee != "power") {
                 cout << "不认识：" << ttyyppee << "类型的" << net_name << "的输入引脚" << endl;
                 continue;
             }
             for (auto& source : sources) {
-                if (module->comp_map.count(source)) {
-                    auto source_comp = module->comp_map[source];
-                    if (source_comp->type != "nmos" && source_comp->type != "pmos") {
+                auto source_it = module.comp_map.find(source);
+                if (source_it != module.comp_map.end()) {
+                    const Component& source_comp = *source_it->second;
+                    if (!source_comp.pMosNode) {
                         cout << "不认识：" << ttyyppee << "类型的" << net_name << "的输入引脚" << source << endl;
                         continue;
                     }
-                    auto pin = make_shared<Pin>();
-                    pin->pos = { source_comp->x + 5, source_comp->y + source_comp->height / 2 };
-                    pin->layer = source_comp->layer;
-                    net->pins.push_back(pin);
-                    module->routing_grid.via_space[pin->pos.y][pin->pos.x] = true; // 标记过孔位置
+                    addPin(*net, source_comp, mosTerminal(*source_comp.pMosNode, net_name, "drain"));
                 }
                 else {
                     size_t dotpos = source.find('.');
@@ -994,18 +3502,9 @@ void buildNets(shared_ptr<SubModuleNode> module) {
                     else {
                         string submod_name = source.substr(0, dotpos);
                         string input_name = source.substr(dotpos + 1);
-                        if (module->subModuleMap.count(submod_name)) {
-                            int offsetx = module->comp_map[submod_name]->x;
-                            int offsety = module->comp_map[submod_name]->y;
-                            if (module->subModuleMap[submod_name]->pSubModuleNode->comp_map.count(input_name)) {
-                                auto input_comp = module->subModuleMap[submod_name]->pSubModuleNode->comp_map[input_name];
-                                auto pin = make_shared<Pin>();
-                                pin->pos = { offsetx + input_comp->x + input_comp->width / 2, offsety + input_comp->y + input_comp->height / 2 };
-                                pin->layer = input_comp->layer;
-                                net->pins.push_back(pin);
-								module->routing_grid.via_space[pin->pos.y][pin->pos.x] = true; // 标记过孔位置
-                            }
-                            else {
+                        auto inst_it = module.subModuleMap.find(submod_name);
+                        if (inst_it != module.subModuleMap.end()) {
+                            if (!addPin(*net, *inst_it->second, input_name)) {
                                 cout << "布线时对于网络" + net_name + "的输入端口" + source + "的子模块" + submod_name + "未找到输入端" + input_name << endl;
                             }
                         }
@@ -1016,22 +3515,213 @@ void buildNets(shared_ptr<SubModuleNode> module) {
                 }
             }
         }
-        module->nets.push_back(net);
-        builded_nets.push_back(module->module_name); // 记录已构建的nets类型
+        module.nets.push_back(net);
     }
-    cout << "初始化布线" + module->module_name << endl;
-    for (auto& net : module->nets) { 
-        reRoute(*net, module->routing_grid); 
+    // 引脚接入点统一保留
+    for (const auto& net : module.nets) reservePinCells(*net, module.routing_grid);
+}
+
+// 把子模块的占用按字或入当前布线网
+void stampChildOccupancy(SubModuleNode& module) {
+    for (auto& comp : module.components) {
+        if (!comp->pSubModuleNode) continue;
+        const auto& tile = comp->pSubModuleNode->occupancy_tile;
+        if (!tile) continue;
+        for (size_t l = 0; l < tile->size() && l < module.routing_grid.metal_layers.size(); ++l) {
+            module.routing_grid.metal_layers[l].used.orShifted((*tile)[l], comp->x, comp->y);
+        }
+    }
+}
+
+// 仍有冲突的线网（两两重叠的双方）
+vector<shared_ptr<Net>> conflictingNets(const SubModuleNode& module) {
+    const auto& nets = module.nets;
+    vector<char> bad(nets.size(), 0);
+    for (size_t i = 0; i < nets.size(); ++i) {
+        for (size_t j = i + 1; j < nets.size(); ++j) {
+            if (checkNetOverlap(*nets[i], *nets[j])) bad[i] = bad[j] = 1;
+        }
+    }
+    vector<shared_ptr<Net>> result;
+    for (size_t i = 0; i < nets.size(); ++i) {
+        if (bad[i]) result.push_back(nets[i]);
+    }
+    return result;
+}
+
+// 布线失败的模块：记下冲突线网引脚所在的元件，重新布局时在其四周留出空隙
+void recordHotspots(SubModuleNode& module) {
+    auto& cells = inflated_cells[module.module_name];
+    for (const auto& net : conflictingNets(module)) {
+        for (const auto& pin : net->pins) {
+            for (const auto& comp : module.components) {
+                if (comp->type == "input" || comp->type == "output" || comp->type == "power" || comp->type == "wire") continue;
+                if (pin->pos.x >= comp->x && pin->pos.x < comp->x + comp->width &&
+                    pin->pos.y >= comp->y && pin->pos.y < comp->y + comp->height) cells.insert(comp->name);
+            }
+        }
+    }
+    failed_modules.insert(module.module_name);
+}
+
+// 作废布线失败的模块及其所有上层模块的布局和布线，返回作废的模块数
+int invalidateFailedModules(SubModuleNode& module) {
+    bool stale = failed_modules.count(module.module_name) > 0;
+    unordered_set<string> seen;
+    for (auto& comp : module.components) {
+        if (comp->pSubModuleNode && seen.insert(comp->type).second && invalidateFailedModules(*comp->pSubModuleNode) > 0) stale = true;
+    }
+    if (!stale) return 0;
+    if (replaced_modules.insert(module.module_name).second) {
+        Layouted_map.erase(module.module_name);
+        builded_nets.erase(module.module_name);
+        pin_access_db.erase(module.module_name);
+        module.nets.clear();
+    }
+    return 1;
+}
+
+// 布线检查：模块nets转为检查器的输入，边界取布线网的大小
+long long drc_violations = 0;
+
+void checkModuleRoute(const SubModuleNode& module) {
+    drc::Layout layout;
+    layout.name = module.module_name;
+    layout.width = module.routing_grid.width;
+    layout.height = module.routing_grid.height;
+    layout.layers = module.routing_grid.metal_layers.size();
+    for (const auto& net : module.nets) {
+        int id = layout.addNet(net->name);
+        for (const auto& pin : net->pins) layout.addPin(id, pin->layer, pin->pos.x, pin->pos.y);
+        for (const auto& seg : net->segments) layout.addSegment(id, seg.layer, seg.start.x, seg.start.y, seg.end.x, seg.end.y);
+        for (const auto& via : net->vias) layout.addVia(id, via.x, via.y);
+    }
+    drc::Report report = drc::check(layout, ROUTE_THREADS);
+    drc::printReport(module.module_name, report);
+    drc_violations += report.shorts + report.opens + report.off_grid + report.out_of_bounds + report.via_conflicts;
+}
+
+// 内存预算：按完成顺序记录nets和布线网仍在内存中的模块，超出预算时从最早完成的开始溢出
+deque<SubModuleNode*> resident_modules;
+size_t resident_peak = 0;
+int spilled_count = 0;
+
+// 模块布线数据（布线网和nets）占用的内存估计
+size_t routeMemoryBytes(const SubModuleNode& module) {
+    size_t bytes = module.routing_grid.memoryBytes();
+    for (const auto& net : module.nets) {
+        bytes += sizeof(Net) + net->name.capacity();
+        bytes += net->pins.capacity() * sizeof(shared_ptr<Pin>) + net->pins.size() * (sizeof(Pin) + 16);
+        bytes += net->segments.capacity() * sizeof(Segment) + net->vias.capacity() * sizeof(Point);
+    }
+    return bytes;
+}
+
+// 把nets以MessagePack写入溢出目录，释放nets和布线网；上层只需要occupancy_tile
+bool spillModule(SubModuleNode& module) {
+    error_code ec;
+    filesystem::create_directories(SPILL_DIR, ec);
+    string path = (filesystem::path(SPILL_DIR) / (to_string(spilled_count) + ".msgpack")).string();
+    ofstream out(path, ios::binary);
+    if (!out.is_open()) {
+        cerr << "无法写入溢出文件: " << path << endl;
+        return false;
+    }
+    vector<uint8_t> bytes = json::to_msgpack(netsToCacheJson(module.nets));
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    if (!out) {
+        cerr << "无法写入溢出文件: " << path << endl;
+        return false;
+    }
+    module.spill_path = path;
+    vector<shared_ptr<Net>>().swap(module.nets);
+    module.routing_grid = RoutingGrid();
+    ++spilled_count;
+    return true;
+}
+
+vector<shared_ptr<Net>> loadSpilledNets(const SubModuleNode& module) {
+    ifstream in(module.spill_path, ios::binary);
+    if (!in.is_open()) {
+        cerr << "无法读取溢出文件: " << module.spill_path << endl;
+        return {};
+    }
+    vector<uint8_t> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    return netsFromCacheJson(json::from_msgpack(bytes));
+}
+
+// 模块布线完成后登记，常驻总量超出预算时溢出最早完成的模块
+void enforceMemoryBudget(SubModuleNode& finished) {
+    if (MEMORY_BUDGET_MB == 0) return;
+    resident_modules.erase(remove(resident_modules.begin(), resident_modules.end(), &finished), resident_modules.end());
+    resident_modules.push_back(&finished);
+    size_t total = 0;
+    for (auto* module : resident_modules) total += routeMemoryBytes(*module);
+    resident_peak = max(resident_peak, total);
+    size_t budget = MEMORY_BUDGET_MB << 20;
+    while (total > budget && !resident_modules.empty()) {
+        SubModuleNode* victim = resident_modules.front();
+        resident_modules.pop_front();
+        size_t bytes = routeMemoryBytes(*victim);
+        if (!spillModule(*victim)) break;
+        total -= bytes;
+        cout << "内存超出预算，溢出模块" << victim->module_name << "的布线（" << bytes / 1024 << "KB）" << endl;
     }
-    rerouteConflictingNets(*module);
+}
+
+void buildNets(shared_ptr<SubModuleNode> module) {
+    // 先递归处理子模块，再把子模块的占用按字或入当前布线网
+    for (auto& comp : module->components) {
+        if (comp->pSubModuleNode && !builded_nets.count(comp->type)) buildNets(comp->pSubModuleNode);
+    }
+    stampChildOccupancy(*module);
+    // 命中缓存时直接恢复已布好的nets
+    json cached = loadCacheEntry(*module);
+    if (!cached.is_null() && cached.contains("nets")) {
+        module->spill_path.clear();
+        module->nets = netsFromCacheJson(cached["nets"]);
+        for (auto& net : module->nets) {
+            reservePinCells(*net, module->routing_grid);
+            markNetOnGrid(*net, module->routing_grid);
+        }
+        builded_nets.insert(module->module_name);
+        buildOccupancyTile(*module);
+        cout << "从缓存载入布线" + module->module_name << endl;
+        if (CHECK_ROUTE) checkModuleRoute(*module);
+        enforceMemoryBudget(*module);
+        return;
+    }
+    module->spill_path.clear();
+    createModuleNets(*module);
+    builded_nets.insert(module->module_name); // 记录已构建nets的模块类型
+    ecoRestoreNets(*module);
+    if (POWER_LAYERS > 0) synthesizePowerNets(*module);
+    long long searches_before = route_stats.searches, expanded_before = route_stats.expanded;
+    if (GCELL_SIZE > 0) module->route_overflow = globalRoute(*module);
+    cout << "初始化布线" + module->module_name << endl;
+    // 初次布线只读网格，各线网互不影响，可并行
+    routePool().parallelFor(module->nets.size(), [&](int i) {
+        if (!module->nets[i]->fixed) reRoute(*module->nets[i], module->routing_grid);
+    });
+    if (!rerouteConflictingNets(*module) && REPLACE_RETRIES > 0) recordHotspots(*module);
     for (auto neet : module->nets) {
         markNetOnGrid(*neet, module->routing_grid);
     }
+    buildOccupancyTile(*module);
+    cout << "布线网占用内存" << module->routing_grid.memoryBytes() / 1024 << "KB" << endl;
+    cout << "A*搜索" << route_stats.searches - searches_before << "次，扩展节点"
+        << route_stats.expanded - expanded_before << "个" << endl;
+    if (!cached.is_null()) {
+        cached["nets"] = netsToCacheJson(module->nets);
+        storeCacheEntry(*module, cached);
+    }
+    if (CHECK_ROUTE) checkModuleRoute(*module);
+    enforceMemoryBudget(*module);
 }
 
-// 初始布局算法：网格布局，input和power在左边，除了output的其他在中间，output在右边
+// 初始布局算法：input和power在左边，除了output的其他在中间，output在右边。
+// 每组先按列依次堆叠得到期望位置，再由合法化器消除重叠
 void initialLayout(shared_ptr<SubModuleNode> Module) {
-    int x = 0, y = 0;
     // max_width = 总元件数量的平方根乘以平均元件宽度
     if (Module->components.empty()) return; // 如果没有组件，直接返回
     // 遍历计算平均宽度
@@ -1040,137 +3730,329 @@ void initialLayout(shared_ptr<SubModuleNode> Module) {
         total_width += comp->width;
     }
     int max_width = 1.5 * static_cast<int>(sqrt(Module->components.size())) * (total_width / Module->components.size());
-    // 换行时x坐标增量
-    int line_width = 0;
 
-    // 布局输入和电源
-    vector<shared_ptr<Component>> placed_components;
     // 布局线
     for (auto& comp : Module->components) {
         if (comp->type == "wire") {
             comp->x = -10000;
             comp->y = -10000;
-            placed_components.push_back(comp);
         }
     }
-    for (auto& comp : Module->components) {
-        if (comp->type == "input" || comp->type == "power") {
-            // 输入和电源在左边
-            comp->x = x;
-            comp->y = y;
-
-            // 碰撞检测与位置调整
-            bool has_overlap;
-            do {
-                has_overlap = false;
-                for (const auto& existing : placed_components) {
-                    if (comp->x < existing->x + existing->width && comp->x + comp->width > existing->x && comp->y < existing->y + existing->height && comp->y + comp->height > existing->y) {
-                        has_overlap = true;
-                        y += comp->height + 1; // 增加间距到2
-                        comp->y = y;
-                        if (y > max_width) {
-                            y = 0;
-                            x += line_width + 1;
-                            line_width = 0;
-                            comp->x = x;
-                        }
-                        break;
-                    }
-                }
-            } while (has_overlap);
 
-            line_width = max(line_width, comp->height);
-            y += comp->height + 1; // 增加间距到2
-            if (y > max_width) {
+    int x = 0;
+    auto placeGroup = [&](const function<bool(const Component&)>& pick) {
+        vector<shared_ptr<Component>> group;
+        int y = 0;
+        int line_width = 0; // 当前列宽
+        for (auto& comp : Module->components) {
+            if (!pick(*comp)) continue;
+            if (y > 0 && y + comp->height > max_width) {
                 y = 0;
                 x += line_width + 1;
                 line_width = 0;
             }
-            placed_components.push_back(comp);
+            comp->x = x;
+            comp->y = y;
+            y += comp->height + 1;
+            line_width = max(line_width, comp->width);
+            group.push_back(comp);
         }
+        if (group.empty()) return;
+        legalizeComponents(group, 1, max_width);
+        for (const auto& comp : group) x = max(x, comp->x + comp->width + 1);
+    };
+    // 输入和电源在左边
+    placeGroup([](const Component& c) { return c.type == "input" || c.type == "power"; });
+    // 其他组件在中间
+    placeGroup([](const Component& c) {
+        return c.type != "input" && c.type != "power" && c.type != "output" && c.type != "wire";
+    });
+    // 输出在右边
+    placeGroup([](const Component& c) { return c.type == "output"; });
+}
+
+// 按实例名拆出末尾的序号：p3、reg_3、u_add[3]分别得到(p, 3)、(reg_, 3)、(u_add, 3)
+bool splitIndex(const string& name, string& prefix, int& index) {
+    size_t end = name.size();
+    if (end > 0 && name[end - 1] == ']') {
+        size_t open = name.rfind('[');
+        if (open == string::npos) return false;
+        prefix = name.substr(0, open);
+        string digits = name.substr(open + 1, end - open - 2);
+        if (digits.empty() || digits.size() > 9 || !all_of(digits.begin(), digits.end(), ::isdigit)) return false;
+        index = stoi(digits);
+        return !prefix.empty();
     }
-    y = 0;
-    x += line_width + 1;
-    line_width = 0; // 重置行高
+    size_t start = end;
+    while (start > 0 && isdigit((unsigned char)name[start - 1])) start--;
+    if (start == end || start == 0 || end - start > 9) return false;
+    prefix = name.substr(0, start);
+    index = stoi(name.substr(start));
+    return true;
+}
 
-    // 布局除了output的其他组件
-    placed_components.clear();
-    for (auto& comp : Module->components) {
-        if (comp->type != "input" && comp->type != "power" && comp->type != "output" && comp->type != "wire") {
-            // 其他组件在中间
-            comp->x = x;
-            comp->y = y;
+// 刚性宏：成员元件按固定的相对位置组成一个块，退火时作为一个元件移动
+struct RigidMacro {
+    shared_ptr<Component> macro;
+    vector<shared_ptr<Component>> members;
+    vector<Point> offsets; // 成员相对宏左下角的位置
+};
 
-            // 碰撞检测与位置调整
-            bool has_overlap;
-            do {
-                has_overlap = false;
-                for (const auto& existing : placed_components) {
-                    if (comp->x < existing->x + existing->width && comp->x + comp->width > existing->x && comp->y < existing->y + existing->height && comp->y + comp->height > existing->y) {
-                        has_overlap = true;
-                        y += comp->height + 1;
-                        comp->y = y;
-                        if (y > max_width) {
-                            y = 0;
-                            x += line_width + 1;
-                            line_width = 0;
-                            comp->x = x;
-                        }
-                        break;
-                    }
-                }
-            } while (has_overlap);
+// 宏替换：退火前把成员换成宏，退火后按宏的位置展开成员并恢复元件表和连接映射
+struct MacroPlacement {
+    vector<RigidMacro> macros;
+    vector<shared_ptr<Component>> components;
+    unordered_map<string, vector<shared_ptr<Component>>> in_map, out_map;
+
+    void expand(SubModuleNode& module) {
+        if (macros.empty()) return;
+        for (const auto& m : macros) {
+            for (size_t i = 0; i < m.members.size(); ++i) {
+                m.members[i]->x = m.macro->x + m.offsets[i].x;
+                m.members[i]->y = m.macro->y + m.offsets[i].y;
+                m.members[i]->layer = m.macro->layer;
+            }
+        }
+        module.components = move(components);
+        module.in_map = move(in_map);
+        module.out_map = move(out_map);
+        macros.clear();
+    }
+};
 
-            line_width = max(line_width, comp->height);
-            y += comp->height + 1;
-            if (y > max_width) {
-                y = 0;
-                x += line_width + 1;
-                line_width = 0;
+// 识别阵列并换成宏。名字为"前缀+序号"、类型和尺寸相同的元件至少ARRAY_MIN_SIZE个
+// 组成一列；序号集合相同、且多数序号上两列元件共用信号线网的列合并为位片，每个
+// 序号一片，片内各列按前缀顺序自下而上叠放。各片按序号蛇形排成接近方形的若干行，
+// 相邻序号总是相邻，片间和行间留ARRAY_CHANNEL宽的布线通道，整块作为一个元件参与退火
+MacroPlacement collapseMacros(SubModuleNode& module, vector<RigidMacro> macros);
+
+MacroPlacement collapseArrays(SubModuleNode& module) {
+    MacroPlacement result;
+    map<pair<string, string>, map<int, shared_ptr<Component>>> columns;
+    for (const auto& comp : module.components) {
+        if (comp->fixed || comp->type == "input" || comp->type == "output"
+            || comp->type == "power" || comp->type == "wire") continue;
+        string prefix;
+        int index;
+        if (splitIndex(comp->name, prefix, index)) columns[{ prefix, comp->type }][index] = comp;
+    }
+    vector<map<int, shared_ptr<Component>>> cols;
+    for (auto& [key, col] : columns) {
+        if ((int)col.size() < ARRAY_MIN_SIZE) continue;
+        const auto& first = col.begin()->second;
+        bool uniform = all_of(col.begin(), col.end(), [&](const auto& e) {
+            return e.second->width == first->width && e.second->height == first->height;
+        });
+        if (uniform) cols.push_back(move(col));
+    }
+    if (cols.empty()) return result;
+
+    // 信号线网（不含电源）
+    auto signalNets = [&](const Component& c) {
+        set<string> nets;
+        for (auto* names : { &c.in, &c.out }) {
+            for (const auto& n : *names) {
+                auto it = module.comp_map.find(n);
+                if (it == module.comp_map.end() || it->second->type != "power") nets.insert(n);
+            }
+        }
+        return nets;
+    };
+    vector<int> group(cols.size());
+    for (size_t i = 0; i < cols.size(); ++i) group[i] = i;
+    for (size_t a = 0; a < cols.size(); ++a) {
+        for (size_t b = a + 1; b < cols.size(); ++b) {
+            if (group[b] != (int)b || cols[a].size() != cols[b].size()) continue;
+            int shared = 0;
+            bool same_index = true;
+            for (auto ia = cols[a].begin(), ib = cols[b].begin(); ia != cols[a].end(); ++ia, ++ib) {
+                if (ia->first != ib->first) { same_index = false; break; }
+                auto na = signalNets(*ia->second), nb = signalNets(*ib->second);
+                if (any_of(na.begin(), na.end(), [&](const string& n) { return nb.count(n) > 0; })) shared++;
+            }
+            if (same_index && 2 * shared > (int)cols[a].size()) group[b] = group[a];
+        }
+    }
+
+    vector<RigidMacro> macros;
+    for (size_t g = 0; g < cols.size(); ++g) {
+        if (group[g] != (int)g) continue;
+        vector<size_t> slice_cols;
+        for (size_t c = 0; c < cols.size(); ++c) if (group[c] == (int)g) slice_cols.push_back(c);
+        int slice_w = 0, slice_h = -ARRAY_CHANNEL;
+        for (size_t c : slice_cols) {
+            slice_w = max(slice_w, cols[c].begin()->second->width);
+            slice_h += cols[c].begin()->second->height + ARRAY_CHANNEL;
+        }
+        int n = cols[g].size();
+        int rows = max(1, (int)lround(sqrt(double(n) * (slice_w + ARRAY_CHANNEL) / (slice_h + ARRAY_CHANNEL))));
+        int per_row = (n + rows - 1) / rows;
+        rows = (n + per_row - 1) / per_row;
+
+        RigidMacro m;
+        m.macro = make_shared<Component>();
+        m.macro->type = "array";
+        m.macro->name = "array:" + cols[g].begin()->second->name;
+        m.macro->width = per_row * (slice_w + ARRAY_CHANNEL) - ARRAY_CHANNEL;
+        m.macro->height = rows * (slice_h + ARRAY_CHANNEL) - ARRAY_CHANNEL;
+        int k = 0;
+        for (const auto& [index, comp] : cols[g]) {
+            int r = k / per_row, c = k % per_row;
+            if (r % 2) c = per_row - 1 - c;
+            int y = r * (slice_h + ARRAY_CHANNEL);
+            for (size_t col : slice_cols) {
+                const auto& member = cols[col].at(index);
+                m.members.push_back(member);
+                m.offsets.push_back({ c * (slice_w + ARRAY_CHANNEL), y });
+                y += member->height + ARRAY_CHANNEL;
+            }
+            k++;
+        }
+        macros.push_back(move(m));
+    }
+    size_t before = module.components.size();
+    result = collapseMacros(module, move(macros));
+    cout << "识别阵列" << result.macros.size() << "个，退火元件数由" << before
+        << "减为" << module.components.size() << endl;
+    return result;
+}
+
+// 用宏替换元件表和连接映射中的成员，返回的MacroPlacement用于展开和恢复
+MacroPlacement collapseMacros(SubModuleNode& module, vector<RigidMacro> macros) {
+    MacroPlacement result;
+    result.macros = move(macros);
+    unordered_map<Component*, Component*> owner; // 成员 -> 宏
+    for (const auto& m : result.macros) {
+        for (const auto& member : m.members) owner[member.get()] = m.macro.get();
+    }
+    result.components = module.components;
+    result.in_map = module.in_map;
+    result.out_map = module.out_map;
+    unordered_map<Component*, shared_ptr<Component>> macro_of;
+    for (const auto& m : result.macros) macro_of[m.macro.get()] = m.macro;
+    vector<shared_ptr<Component>> collapsed;
+    unordered_set<Component*> added;
+    for (const auto& comp : module.components) {
+        auto it = owner.find(comp.get());
+        if (it == owner.end()) collapsed.push_back(comp);
+        else if (added.insert(it->second).second) collapsed.push_back(macro_of[it->second]);
+    }
+    for (auto* m : { &module.in_map, &module.out_map }) {
+        for (auto& [net, comps] : *m) {
+            vector<shared_ptr<Component>> mapped;
+            unordered_set<Component*> seen;
+            for (const auto& c : comps) {
+                auto it = owner.find(c.get());
+                auto target = it == owner.end() ? c : macro_of[it->second];
+                if (seen.insert(target.get()).second) mapped.push_back(target);
+            }
+            comps = move(mapped);
+        }
+    }
+    module.components = move(collapsed);
+    return result;
+}
+
+bool isPortType(const string& type) {
+    return type == "input" || type == "output" || type == "power" || type == "wire";
+}
+
+// 一层粗化：重边匹配。线网给其上每对核心元件加1/(k-1)的边权（k为元件数，超过
+// CLUSTER_NET_LIMIT的线网不计），元件按随机顺序与边权最大、合并后不超过CLUSTER_MAX
+// 个原始元件的未匹配邻居配对，每对紧贴着并排或上下叠放（取更接近方形的一种）组成刚性宏。
+// cells记录各宏包含的原始元件数
+MacroPlacement coarsenOnce(SubModuleNode& module, mt19937& gen, unordered_map<Component*, int>& cells) {
+    vector<shared_ptr<Component>> core;
+    unordered_map<Component*, int> index;
+    for (const auto& comp : module.components) {
+        if (comp->fixed || isPortType(comp->type)) continue;
+        index[comp.get()] = core.size();
+        core.push_back(comp);
+    }
+    auto size = [&](int i) {
+        auto it = cells.find(core[i].get());
+        return it == cells.end() ? 1 : it->second;
+    };
+    int n = core.size();
+    vector<unordered_map<int, double>> adj(n);
+    unordered_set<string> nets;
+    for (auto* m : { &module.in_map, &module.out_map }) for (const auto& [net, comps] : *m) nets.insert(net);
+    for (const auto& net : nets) {
+        vector<int> members;
+        for (auto* m : { &module.in_map, &module.out_map }) {
+            auto it = m->find(net);
+            if (it == m->end()) continue;
+            for (const auto& c : it->second) {
+                auto idx = index.find(c.get());
+                if (idx != index.end()) members.push_back(idx->second);
+            }
+        }
+        sort(members.begin(), members.end());
+        members.erase(unique(members.begin(), members.end()), members.end());
+        int k = members.size();
+        if (k < 2 || k > CLUSTER_NET_LIMIT) continue;
+        for (int a = 0; a < k; ++a) {
+            for (int b = a + 1; b < k; ++b) {
+                adj[members[a]][members[b]] += 1.0 / (k - 1);
+                adj[members[b]][members[a]] += 1.0 / (k - 1);
             }
-            placed_components.push_back(comp);
         }
     }
-    y = 0;
-    x += line_width + 1;
-    line_width = 0; // 重置行高
-    // 布局输出
-    placed_components.clear();
-    for (auto& comp : Module->components) {
-        if (comp->type == "output") {
-            // 输出在右边
-            comp->x = x;
-            comp->y = y;
 
-            // 碰撞检测与位置调整
-            bool has_overlap;
-            do {
-                has_overlap = false;
-                for (const auto& existing : placed_components) {
-                    if (comp->x < existing->x + existing->width && comp->x + comp->width > existing->x && comp->y < existing->y + existing->height && comp->y + comp->height > existing->y) {
-                        has_overlap = true;
-                        y += comp->height + 1;
-                        comp->y = y;
-                        if (y > max_width) {
-                            y = 0;
-                            x += line_width + 1;
-                            line_width = 0;
-                            comp->x = x;
-                        }
-                        break;
-                    }
-                }
-            } while (has_overlap);
-
-            line_width = max(line_width, comp->height);
-            y += comp->height + 1;
-            if (y > max_width) {
-                y = 0;
-                x += line_width + 1;
-                line_width = 0;
-            }
-            placed_components.push_back(comp);
+    vector<int> order(n), mate(n, -1);
+    for (int i = 0; i < n; ++i) order[i] = i;
+    shuffle(order.begin(), order.end(), gen);
+    vector<RigidMacro> macros;
+    for (int u : order) {
+        if (mate[u] >= 0) continue;
+        int best = -1;
+        double best_w = 0.0;
+        for (auto [v, w] : adj[u]) {
+            if (mate[v] >= 0 || size(u) + size(v) > CLUSTER_MAX) continue;
+            if (w > best_w || (w == best_w && v < best)) { best = v; best_w = w; }
         }
+        if (best < 0) continue;
+        mate[u] = best;
+        mate[best] = u;
+        const auto& a = core[u];
+        const auto& b = core[best];
+        int side_w = a->width + b->width, side_h = max(a->height, b->height);
+        int stack_w = max(a->width, b->width), stack_h = a->height + b->height;
+        bool side = max(side_w, side_h) <= max(stack_w, stack_h);
+        RigidMacro m;
+        m.macro = make_shared<Component>();
+        m.macro->type = "cluster";
+        m.macro->name = "cluster:" + a->name;
+        m.macro->width = side ? side_w : stack_w;
+        m.macro->height = side ? side_h : stack_h;
+        m.members = { a, b };
+        m.offsets = { { 0, 0 }, side ? Point{ a->width, 0 } : Point{ 0, a->height } };
+        cells[m.macro.get()] = size(u) + size(best);
+        macros.push_back(move(m));
+    }
+    return collapseMacros(module, move(macros));
+}
+
+// 多级布局：逐层粗化到MULTILEVEL_LEVELS层（或无法再匹配）后在最粗一层正常布局，
+// 再逐层展开，每层展开后以低温退火细化
+void multilevelLayout(shared_ptr<SubModuleNode> Module, int width_bound, int height_bound) {
+    random_device rd;
+    mt19937 gen(RANDOM_SEED >= 0 ? (unsigned)RANDOM_SEED : rd());
+    unordered_map<Component*, int> cells;
+    vector<MacroPlacement> levels;
+    size_t before = Module->components.size();
+    for (int level = 0; level < MULTILEVEL_LEVELS; ++level) {
+        auto coarse = coarsenOnce(*Module, gen, cells);
+        if (coarse.macros.empty()) break;
+        levels.push_back(move(coarse));
+    }
+    cout << "多级布局：粗化" << levels.size() << "层，元件数由" << before << "减为" << Module->components.size() << endl;
+    initialLayout(Module);
+    mixed_layout(Module->components, Module->in_map, Module->out_map, width_bound, height_bound);
+    while (!levels.empty()) {
+        levels.back().expand(*Module);
+        levels.pop_back();
+        mixed_layout(Module->components, Module->in_map, Module->out_map, width_bound, height_bound, INIT_TEMP * REFINE_TEMP_RATIO);
     }
 }
 
@@ -1208,9 +4090,43 @@ void layout(shared_ptr<SubModuleNode> Module) {
             }
         }
     }
-    cout << "布局" + Module->module_name + "中……" << endl;
-    initialLayout(Module);
-    mixed_layout(Module->components, Module->in_map, Module->out_map, width_bound, height_bound);
+    // 命中缓存时跳过退火
+    json cached = loadCacheEntry(*Module);
+    if (!cached.is_null() && restoreLayoutFromCache(*Module, cached)) {
+        auto [width, height] = component_sizes[Module->module_name];
+        Module->routing_grid = RoutingGrid(width, height, MAX_METAL_LAYER);
+        Layouted_map[Module->module_name] = Module;
+        std::cout << "从缓存载入布局" << Module->module_name << "，大小为" << width << "x" << height << endl;
+        return;
+    }
+    auto hot = inflated_cells.find(Module->module_name);
+    if (hot != inflated_cells.end() || !ecoLayout(Module, width_bound, height_bound)) {
+        cout << "布局" + Module->module_name + "中……" << endl;
+        // 上次布线失败处的元件带着四周的空隙参与布局
+        vector<shared_ptr<Component>> inflated;
+        if (hot != inflated_cells.end()) {
+            for (auto& comp : Module->components) {
+                if (!hot->second.count(comp->name)) continue;
+                comp->width += 2 * INFLATE_HALO;
+                comp->height += 2 * INFLATE_HALO;
+                inflated.push_back(comp);
+            }
+        }
+        MacroPlacement arrays;
+        if (ARRAY_PLACE) arrays = collapseArrays(*Module);
+        if (MULTILEVEL_LEVELS > 0) multilevelLayout(Module, width_bound, height_bound);
+        else {
+            initialLayout(Module);
+            mixed_layout(Module->components, Module->in_map, Module->out_map, width_bound, height_bound);
+        }
+        arrays.expand(*Module);
+        for (auto& comp : inflated) {
+            comp->x += INFLATE_HALO;
+            comp->y += INFLATE_HALO;
+            comp->width -= 2 * INFLATE_HALO;
+            comp->height -= 2 * INFLATE_HALO;
+        }
+    }
 
     // 计算模块宽度、高度
     int min_x = 1000000, min_y = 1000000, max_x = -1000000, max_y = -1000000;
@@ -1237,7 +4153,257 @@ void layout(shared_ptr<SubModuleNode> Module) {
 
     // 将布局信息储存到Layouted_map
     Layouted_map[Module->module_name] = Module;
-    std::cout << "布局模块" << Module->module_name << "完成，大小为" << int(width) << "x" << int(height) << endl;
+    storeCacheEntry(*Module, layoutToCacheJson(*Module));
+    NetModel estimate;
+    estimate.build(Module->components, Module->in_map, Module->out_map);
+    std::cout << "布局模块" << Module->module_name << "完成，大小为" << int(width) << "x" << int(height)
+        << "，估计线长" << estimate.steinerLength() << endl;
+}
+
+// FM二分：把cells分成两侧，左侧元件数尽量接近left_target，返回每个元件在哪一侧
+vector<int> fmBisect(const vector<vector<int>>& net_cells, const vector<vector<int>>& cell_nets,
+                     const vector<int>& cells, int left_target) {
+    int n = cells.size();
+    unordered_map<int, int> local;
+    for (int i = 0; i < n; ++i) local[cells[i]] = i;
+    // 只保留在本组内至少连两个元件的线网
+    vector<vector<int>> nets;
+    vector<vector<int>> nets_of(n);
+    unordered_set<int> seen;
+    for (int c : cells) {
+        for (int e : cell_nets[c]) {
+            if (!seen.insert(e).second) continue;
+            vector<int> members;
+            for (int m : net_cells[e]) {
+                auto it = local.find(m);
+                if (it != local.end()) members.push_back(it->second);
+            }
+            if (members.size() < 2) continue;
+            for (int m : members) nets_of[m].push_back(nets.size());
+            nets.push_back(move(members));
+        }
+    }
+
+    // 初始划分：按连接广度优先排序，前left_target个放左侧
+    vector<int> side(n, 1);
+    vector<char> visited(n, 0);
+    int assigned = 0;
+    for (int start = 0; start < n && assigned < left_target; ++start) {
+        if (visited[start]) continue;
+        queue<int> bfs;
+        bfs.push(start);
+        visited[start] = 1;
+        while (!bfs.empty() && assigned < left_target) {
+            int c = bfs.front();
+            bfs.pop();
+            side[c] = 0;
+            ++assigned;
+            for (int e : nets_of[c]) {
+                for (int m : nets[e]) {
+                    if (!visited[m]) { visited[m] = 1; bfs.push(m); }
+                }
+            }
+        }
+    }
+
+    int tolerance = max(1, int(n * PARTITION_BALANCE));
+    int lo = max(1, left_target - tolerance), hi = min(n - 1, left_target + tolerance);
+    vector<array<int, 2>> count(nets.size());
+    vector<int> gain(n);
+    vector<char> locked(n);
+    for (int pass = 0; pass < FM_PASSES; ++pass) {
+        for (auto& cnt : count) cnt = { 0, 0 };
+        for (int e = 0; e < (int)nets.size(); ++e)
+            for (int m : nets[e]) ++count[e][side[m]];
+        // 增益：移动后割网络减少的条数
+        set<pair<int, int>, greater<pair<int, int>>> bucket[2];
+        for (int c = 0; c < n; ++c) {
+            gain[c] = 0;
+            for (int e : nets_of[c]) {
+                if (count[e][side[c]] == 1) ++gain[c];
+                if (count[e][1 - side[c]] == 0) --gain[c];
+            }
+            bucket[side[c]].insert({ gain[c], c });
+        }
+        fill(locked.begin(), locked.end(), 0);
+        auto adjust = [&](int c, int delta) {
+            if (locked[c] || delta == 0) return;
+            bucket[side[c]].erase({ gain[c], c });
+            gain[c] += delta;
+            bucket[side[c]].insert({ gain[c], c });
+        };
+        int left = count_if(side.begin(), side.end(), [](int s) { return s == 0; });
+        vector<int> moves;
+        int total = 0, best_total = 0, best_len = 0;
+        while (true) {
+            // 两侧各取增益最大者，只考虑不破坏平衡的一侧
+            int pick = -1;
+            for (int from = 0; from < 2; ++from) {
+                if (bucket[from].empty()) continue;
+                int next_left = left + (from == 0 ? -1 : 1);
+                if (next_left < lo || next_left > hi) continue;
+                int c = bucket[from].begin()->second;
+                if (pick < 0 || gain[c] > gain[pick]) pick = c;
+            }
+            if (pick < 0) break;
+            int from = side[pick], to = 1 - from;
+            bucket[from].erase({ gain[pick], pick });
+            locked[pick] = 1;
+            total += gain[pick];
+            for (int e : nets_of[pick]) {
+                if (count[e][to] == 0) {
+                    for (int m : nets[e]) adjust(m, 1);
+                } else if (count[e][to] == 1) {
+                    for (int m : nets[e]) if (side[m] == to) adjust(m, -1);
+                }
+                --count[e][from];
+                ++count[e][to];
+                if (count[e][from] == 0) {
+                    for (int m : nets[e]) adjust(m, -1);
+                } else if (count[e][from] == 1) {
+                    for (int m : nets[e]) if (side[m] == from && m != pick) adjust(m, 1);
+                }
+            }
+            side[pick] = to;
+            left += from == 0 ? -1 : 1;
+            moves.push_back(pick);
+            if (total > best_total) {
+                best_total = total;
+                best_len = moves.size();
+            }
+        }
+        // 回退到收益最大的前缀
+        for (int k = moves.size() - 1; k >= best_len; --k) side[moves[k]] = 1 - side[moves[k]];
+        if (best_total <= 0) break;
+    }
+    return side;
+}
+
+// 递归二分，直到每份不超过目标块数对应的规模
+void recursiveBisect(const vector<vector<int>>& net_cells, const vector<vector<int>>& cell_nets,
+                     const vector<int>& cells, int parts, vector<int>& part_of, int& next_part) {
+    if (parts <= 1 || cells.size() < 2) {
+        for (int c : cells) part_of[c] = next_part;
+        ++next_part;
+        return;
+    }
+    int left_parts = parts / 2;
+    int left_target = int((long long)cells.size() * left_parts / parts);
+    vector<int> side = fmBisect(net_cells, cell_nets, cells, left_target);
+    vector<int> halves[2];
+    for (int i = 0; i < (int)cells.size(); ++i) halves[side[i]].push_back(cells[i]);
+    recursiveBisect(net_cells, cell_nets, halves[0], left_parts, part_of, next_part);
+    recursiveBisect(net_cells, cell_nets, halves[1], parts - left_parts, part_of, next_part);
+}
+
+// 把MOS数超过PARTITION_SIZE的平面模块按最小割切成若干合成子模块，
+// 之后按普通层次设计逐个布局布线
+void partitionFlatModules(json& all_modules) {
+    if (PARTITION_SIZE <= 0) return;
+    vector<string> targets;
+    for (auto& [name, module_json] : all_modules.items()) {
+        if (module_json.contains("subModules") && !module_json["subModules"].is_null() && !module_json["subModules"].empty()) continue;
+        if (module_json.contains("mosfets") && (int)module_json["mosfets"].size() > PARTITION_SIZE) targets.push_back(name);
+    }
+    for (const string& name : targets) {
+        json& module_json = all_modules[name];
+        vector<string> mos_names;
+        unordered_map<string, int> mos_index;
+        for (auto& [mos, data] : module_json["mosfets"].items()) {
+            mos_index[mos] = mos_names.size();
+            mos_names.push_back(mos);
+        }
+        // 线网超图（电源网络不参与割）
+        vector<vector<int>> net_cells;
+        vector<vector<int>> cell_nets(mos_names.size());
+        for (auto& [net, data] : module_json["ports"].items()) {
+            if (data["type"] == "power") continue;
+            vector<int> members;
+            for (const char* key : { "in", "out" }) {
+                if (!data.contains(key)) continue;
+                for (auto& entry : data[key]) {
+                    auto it = mos_index.find(entry.get<string>());
+                    if (it != mos_index.end()) members.push_back(it->second);
+                }
+            }
+            sort(members.begin(), members.end());
+            members.erase(unique(members.begin(), members.end()), members.end());
+            if (members.size() < 2) continue;
+            for (int m : members) cell_nets[m].push_back(net_cells.size());
+            net_cells.push_back(move(members));
+        }
+        int parts = (mos_names.size() + PARTITION_SIZE - 1) / PARTITION_SIZE;
+        vector<int> all_cells(mos_names.size());
+        iota(all_cells.begin(), all_cells.end(), 0);
+        vector<int> part_of(mos_names.size(), 0);
+        int next_part = 0;
+        recursiveBisect(net_cells, cell_nets, all_cells, parts, part_of, next_part);
+
+        vector<json> children(next_part);
+        vector<string> child_names(next_part), inst_names(next_part);
+        for (int k = 0; k < next_part; ++k) {
+            child_names[k] = name + "__part" + to_string(k);
+            inst_names[k] = "part" + to_string(k);
+            children[k]["ports"] = json::object();
+            children[k]["mosfets"] = json::object();
+        }
+        for (int m = 0; m < (int)mos_names.size(); ++m) {
+            children[part_of[m]]["mosfets"][mos_names[m]] = module_json["mosfets"][mos_names[m]];
+        }
+        // 每个端口按块拆开：块内端点移入子模块，父模块改连子模块端口
+        json parent_ports = json::object();
+        vector<json> connections(next_part, json::object());
+        int cut = 0;
+        for (auto& [net, data] : module_json["ports"].items()) {
+            string type = data["type"].get<string>();
+            map<int, array<json, 2>> per_part;
+            json kept[2] = { json::array(), json::array() };
+            const char* keys[2] = { "in", "out" };
+            for (int d = 0; d < 2; ++d) {
+                if (!data.contains(keys[d])) continue;
+                for (auto& entry : data[keys[d]]) {
+                    auto it = mos_index.find(entry.get<string>());
+                    if (it == mos_index.end()) { kept[d].push_back(entry); continue; }
+                    auto& lists = per_part[part_of[it->second]];
+                    if (lists[d].is_null()) lists[d] = json::array();
+                    lists[d].push_back(entry);
+                }
+            }
+            // 只在一个块内部的wire直接下放
+            if (type == "wire" && per_part.size() == 1 && kept[0].empty() && kept[1].empty()) {
+                auto& [k, lists] = *per_part.begin();
+                json port = { {"type", "wire"} };
+                if (!lists[0].is_null()) port["in"] = lists[0];
+                if (!lists[1].is_null()) port["out"] = lists[1];
+                children[k]["ports"][net] = port;
+                continue;
+            }
+            if (type != "power" && per_part.size() > 1) ++cut;
+            for (auto& [k, lists] : per_part) {
+                string child_type = type == "power" ? "power" : !lists[0].is_null() ? "output" : "input";
+                json port = { {"type", child_type} };
+                if (!lists[0].is_null()) port["in"] = lists[0];
+                if (!lists[1].is_null()) port["out"] = lists[1];
+                children[k]["ports"][net] = port;
+                connections[k][net] = net;
+                kept[child_type == "output" ? 0 : 1].push_back(inst_names[k] + "." + net);
+            }
+            json port = data;
+            port.erase("in");
+            port.erase("out");
+            if (!kept[0].empty()) port["in"] = kept[0];
+            if (!kept[1].empty()) port["out"] = kept[1];
+            parent_ports[net] = port;
+        }
+        module_json["ports"] = parent_ports;
+        module_json.erase("mosfets");
+        module_json["subModules"] = json::object();
+        for (int k = 0; k < next_part; ++k) {
+            module_json["subModules"][inst_names[k]] = { {"module", child_names[k]}, {"connections", connections[k]} };
+            all_modules[child_names[k]] = children[k];
+        }
+        cout << "模块" << name << "按最小割切分为" << next_part << "个子模块，跨块线网" << cut << "条" << endl;
+    }
 }
 
 shared_ptr<SubModuleNode> JsonToAST(const json& all_modules, const string& module_name) {
@@ -1250,6 +4416,7 @@ shared_ptr<SubModuleNode> JsonToAST(const json& all_modules, const string& modul
     auto module_node = make_shared<SubModuleNode>();
     module_node->name = module_name;
     module_node->module_name = module_name;
+    module_node->content_hash = CACHE_DIR.empty() ? "" : moduleContentHash(all_modules, module_name);
     module_cache[module_name] = module_node;
 
     // 检查模块是否存在
@@ -1278,11 +4445,13 @@ shared_ptr<SubModuleNode> JsonToAST(const json& all_modules, const string& modul
                 for (auto& net : data["in"]) {
                     comp->in.push_back(net.get<string>());
                 }
+                module_node->net_in_map[name] = comp->in;
             }
             if (data.contains("out")) {
                 for (auto& net : data["out"]) {
                     comp->out.push_back(net.get<string>());
                 }
+                module_node->net_out_map[name] = comp->out;
             }
             
             // 记录特殊端口
@@ -1443,6 +4612,16 @@ bool checkNetOverlap(Net& net1, Net& net2) {
         }
     }
 
+    // 检查线段压过另一线网的引脚
+    for (auto [a, b] : { make_pair(&net1, &net2), make_pair(&net2, &net1) }) {
+        for (const auto& pin : b->pins) {
+            Segment dot = { pin->pos, pin->pos, pin->layer };
+            for (const auto& seg : a->segments) {
+                if (segmentsOverlap(seg, dot)) return true;
+            }
+        }
+    }
+
     // 检查过孔重叠
     unordered_set<Point, PointHash> vias1(net1.vias.begin(), net1.vias.end());
     for (const auto& via : net2.vias) {
@@ -1460,17 +4639,149 @@ struct AStarNode {
     int x, y, layer;
     int g, f; // g: actual cost, f: g + heuristic
     bool operator>(const AStarNode& other) const {
-        return f > other.f; // For min-heap
+        return f != other.f ? f > other.f : g < other.g; // For min-heap, ties go deeper first
     }
 };
 
-vector<PathNode> findShortestPath(const Point& start, int start_layer,
+// Sparse per-search state: an open-addressing table keyed by (layer, y, x) that
+// only holds visited nodes, so memory follows the explored region instead of
+// layers x width x height. Entries are invalidated by bumping a stamp, which
+// lets one workspace be reused across searches without clearing.
+struct AStarWorkspace {
+    vector<uint64_t> keys;
+    vector<int> g;
+    vector<uint64_t> parent;
+    vector<uint32_t> stamp;
+    uint32_t cur = 0;
+    size_t used = 0;
+    vector<AStarNode> heap;
+
+    static uint64_t key(int x, int y, int layer) {
+        return ((uint64_t)layer << 48) | ((uint64_t)(uint32_t)y << 24) | (uint32_t)x;
+    }
+    static PathNode node(uint64_t k) {
+        return { int(k & 0xFFFFFF), int((k >> 24) & 0xFFFFFF), int(k >> 48) };
+    }
+    void reset() {
+        if (keys.empty()) resize(1 << 12);
+        if (++cur == 0) {
+            fill(stamp.begin(), stamp.end(), 0);
+            cur = 1;
+        }
+        used = 0;
+        heap.clear();
+    }
+    size_t slot(uint64_t k) const {
+        size_t mask = keys.size() - 1;
+        size_t i = (k * 0x9E3779B97F4A7C15ULL) >> 20 & mask;
+        while (stamp[i] == cur && keys[i] != k) i = (i + 1) & mask;
+        return i;
+    }
+    int getG(uint64_t k) const {
+        size_t i = slot(k);
+        return stamp[i] == cur ? g[i] : INT_MAX;
+    }
+    uint64_t getParent(uint64_t k) const { return parent[slot(k)]; }
+    void put(uint64_t k, int new_g, uint64_t from) {
+        size_t i = slot(k);
+        if (stamp[i] != cur) {
+            if (2 * (used + 1) > keys.size()) {
+                resize(keys.size() * 2);
+                i = slot(k);
+            }
+            stamp[i] = cur;
+            keys[i] = k;
+            used++;
+        }
+        g[i] = new_g;
+        parent[i] = from;
+    }
+    void resize(size_t n) {
+        vector<uint64_t> old_keys = move(keys), old_parent = move(parent);
+        vector<int> old_g = move(g);
+        vector<uint32_t> old_stamp = move(stamp);
+        keys.assign(n, 0);
+        g.assign(n, INT_MAX);
+        parent.assign(n, 0);
+        stamp.assign(n, 0);
+        uint32_t live = cur;
+        if (cur == 0) cur = 1;
+        for (size_t j = 0; j < old_keys.size(); ++j) {
+            if (old_stamp[j] != live || live == 0) continue;
+            size_t i = slot(old_keys[j]);
+            stamp[i] = cur;
+            keys[i] = old_keys[j];
+            g[i] = old_g[j];
+            parent[i] = old_parent[j];
+        }
+    }
+};
+thread_local AStarWorkspace astar_ws, astar_ws_back;
+
+// Routing cost model shared by the search, the MST edge weights in reRoute and
+// the statistics. The heuristic is the exact cost of the obstacle-free
+// relaxation: wire length plus the fewest vias that reach a layer of every
+// orientation still needed and end on the goal layer. It never overestimates
+// and is consistent, so plain A* returns optimal paths; weight > 1 gives
+// weighted A*, which expands fewer nodes but may return longer paths.
+struct RouteCostModel {
+    int wire = 1;               // cost per grid step
+    int via = VIA_COST;         // cost per layer change
+    double weight = 1.0;        // heuristic inflation, 1 = optimal
+    bool bidirectional = false; // search from both ends
+    // Wires may only touch the net's own pin cells where the layer is free there.
+    // Valid when the net itself is not marked on the grid, so an occupied pin
+    // cell means another net's wire ends on it and a via must be used instead.
+    bool exclusive_pins = false;
+
+    int stepCost(const PathNode& a, const PathNode& b) const {
+        return wire * (abs(a.x - b.x) + abs(a.y - b.y)) + via * abs(a.layer - b.layer);
+    }
+    int pathCost(const vector<PathNode>& path) const {
+        int c = 0;
+        for (size_t k = 1; k < path.size(); ++k) c += stepCost(path[k - 1], path[k]);
+        return c;
+    }
+    // Fewest layer changes from each layer to goal_layer that also visit a
+    // horizontal layer (mask bit 0) and/or a vertical layer (mask bit 1)
+    vector<int> viaBounds(const RoutingGrid& grid, int goal_layer) const {
+        int n = grid.signal_layers;
+        vector<int> horiz(n + 1, 0);
+        for (int l = 0; l < n; ++l) horiz[l + 1] = horiz[l] + (grid.metal_layers[l].is_horizontal ? 1 : 0);
+        vector<int> bound(n * 4, 2 * n);
+        for (int l = 0; l < n; ++l) {
+            for (int lo = 0; lo <= min(l, goal_layer); ++lo) {
+                for (int hi = max(l, goal_layer); hi < n; ++hi) {
+                    int h = horiz[hi + 1] - horiz[lo], v = hi - lo + 1 - h;
+                    int walk = (hi - lo) + min(l - lo + hi - goal_layer, hi - l + goal_layer - lo);
+                    for (int mask = 0; mask < 4; ++mask) {
+                        if ((mask & 1) && h == 0) continue;
+                        if ((mask & 2) && v == 0) continue;
+                        bound[l * 4 + mask] = min(bound[l * 4 + mask], walk);
+                    }
+                }
+            }
+        }
+        return bound;
+    }
+};
+RouteCostModel route_cost;
+
+// A* over the routing grid. With jump enabled, moves along a layer's preferred
+// direction slide over free cells in one step and only stop at the last cell
+// before an obstacle, at the target column/row, on a pin of the net, on a cell
+// the other search has reached, or where a legal via exists. Turns only happen
+// through vias, so the skipped cells offer nothing but the straight move and
+// the search stays exact. In bidirectional mode a
+// second search runs from the end pin and the two meet in the middle. A
+// corridor from global routing limits planar moves to its GCells.
+vector<PathNode> searchPath(const Point& start, int start_layer,
     const Point& end, int end_layer,
-    RoutingGrid& grid, Net& net) {
+    RoutingGrid& grid, Net& net, bool jump, const RouteCostModel& cost, const GCellCorridor* corridor) {
     // Get grid dimensions and layers
     int width = grid.width;
     int height = grid.height;
-    int num_layers = grid.metal_layers.size();
+    int num_layers = grid.signal_layers;
 
     // Check if start/end are valid
     if (start.x < 0 || start.x >= width || start.y < 0 || start.y >= height ||
@@ -1480,51 +4791,122 @@ vector<PathNode> findShortestPath(const Point& start, int start_layer,
         cout << "?";
         return {};
     }
+    route_stats.searches++;
+    long long expanded = 0, pushed = 0;
 
     // Define movement directions: right, left, up, down
     vector<Point> directions = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
 
-    // 3D arrays for g-score and came_from
-    vector<vector<vector<int>>> g_score(
-        num_layers,
-        vector<vector<int>>(height, vector<int>(width, INT_MAX))
-    );
+    // Cells holding a pin of this net may be entered even if occupied. Pin access
+    // points are reserved on their layer for the owning net, so those count as free
+    unordered_set<Point, PointHash> pin_cells;
+    unordered_set<uint64_t> pin_nodes;
+    for (auto& a : net.pins) {
+        pin_cells.insert(a->pos);
+        pin_nodes.insert(AStarWorkspace::key(a->pos.x, a->pos.y, a->layer));
+    }
+    auto is_free = [&](int layer, Point p) {
+        return grid.isPositionFree(layer, p) || pin_nodes.count(AStarWorkspace::key(p.x, p.y, layer)) > 0;
+    };
+
+    // Whether a via from p on this layer to a neighbouring layer is legal
+    auto via_legal = [&](Point p, int layer) {
+        if (!grid.isViaFree(p)) return false;
+        return (layer > 0 && is_free(layer - 1, p)) ||
+            (layer + 1 < num_layers && is_free(layer + 1, p));
+    };
+
+    // Side 0 searches from start towards end, side 1 from end towards start
+    struct Side {
+        AStarWorkspace& ws;
+        Point goal;
+        int goal_layer;
+        vector<int> via_bound;
+    };
+    Side sides[2] = {
+        { astar_ws, end, end_layer, cost.viaBounds(grid, end_layer) },
+        { astar_ws_back, start, start_layer, {} },
+    };
+    int num_sides = cost.bidirectional ? 2 : 1;
+    if (num_sides == 2) sides[1].via_bound = cost.viaBounds(grid, start_layer);
 
-    vector<vector<vector<PathNode>>> came_from(
-        num_layers,
-        vector<vector<PathNode>>(height, vector<PathNode>(width, { -1, -1, -1 }))
-    );
+    auto heuristic = [&](const Side& s, int x, int y, int layer) {
+        int dx = abs(x - s.goal.x), dy = abs(y - s.goal.y);
+        int h = cost.wire * (dx + dy) + cost.via * s.via_bound[layer * 4 + (dx ? 1 : 0) + (dy ? 2 : 0)];
+        return cost.weight == 1.0 ? h : int(h * cost.weight);
+    };
 
-    // Priority queue (min-heap) for open nodes
-    priority_queue<AStarNode, vector<AStarNode>, greater<AStarNode>> open_queue;
+    // Best meeting point of the two searches (or the goal when unidirectional)
+    int best = INT_MAX;
+    uint64_t meet = 0;
+    // Without push the node is only recorded: its successors are relaxed on the spot
+    auto relax = [&](int s, int x, int y, int layer, int new_g, uint64_t from, bool push = true) {
+        Side& side = sides[s];
+        uint64_t k = AStarWorkspace::key(x, y, layer);
+        if (new_g >= side.ws.getG(k)) return false;
+        side.ws.put(k, new_g, from);
+        if (push) {
+            side.ws.heap.push_back({ x, y, layer, new_g, new_g + heuristic(side, x, y, layer) });
+            push_heap(side.ws.heap.begin(), side.ws.heap.end(), greater<AStarNode>());
+            pushed++;
+        }
+        if (num_sides == 2) {
+            int other = sides[1 - s].ws.getG(k);
+            if (other != INT_MAX && new_g + other < best) {
+                best = new_g + other;
+                meet = k;
+            }
+        }
+        return true;
+    };
 
-    // Initialize start node
-    g_score[start_layer][start.y][start.x] = 0;
-    int start_h = abs(start.x - end.x) + abs(start.y - end.y) + VIA_COST * abs(start_layer - end_layer);
-    open_queue.push({ start.x, start.y, start_layer, 0, start_h });
+    // Layer switching (vias) from (x, y, layer)
+    auto relaxVias = [&](int s, int x, int y, int layer, int g, uint64_t from) {
+        Point same_point = { x, y };
+        bool is_self = pin_cells.count(same_point) > 0;
+        // Check via availability (via space)
+        if (!grid.isViaFree(same_point) && !is_self) return;
+        for (int layer_offset : {-1, 1}) {
+            int new_layer = layer + layer_offset;
+            if (new_layer < 0 || new_layer >= num_layers) continue;
+            // Check if new layer position is free
+            if (!is_free(new_layer, same_point) && !is_self) continue;
+            relax(s, x, y, new_layer, g + cost.via, from);
+        }
+    };
 
-    while (!open_queue.empty()) {
-        AStarNode current = open_queue.top();
-        open_queue.pop();
+    for (int s = 0; s < num_sides; ++s) sides[s].ws.reset();
+    relax(0, start.x, start.y, start_layer, 0, AStarWorkspace::key(start.x, start.y, start_layer));
+    if (num_sides == 2) relax(1, end.x, end.y, end_layer, 0, AStarWorkspace::key(end.x, end.y, end_layer));
+
+    while (true) {
+        // Expand the side with the smaller open list
+        int s = 0;
+        if (num_sides == 2) {
+            if (sides[0].ws.heap.empty() || sides[1].ws.heap.empty()) break;
+            s = sides[1].ws.heap.size() < sides[0].ws.heap.size() ? 1 : 0;
+            // Any shorter path would have to pass an open node with f below best
+            if (sides[0].ws.heap.front().f >= best || sides[1].ws.heap.front().f >= best) break;
+        }
+        Side& side = sides[s];
+        auto& open_queue = side.ws.heap;
+        if (open_queue.empty()) break;
+        pop_heap(open_queue.begin(), open_queue.end(), greater<AStarNode>());
+        AStarNode current = open_queue.back();
+        open_queue.pop_back();
+        uint64_t current_key = AStarWorkspace::key(current.x, current.y, current.layer);
 
         // Skip if we found a better path already
-        if (current.g > g_score[current.layer][current.y][current.x])
+        if (current.g > side.ws.getG(current_key))
             continue;
 
         // Check if reached end
-        if (current.x == end.x && current.y == end.y && current.layer == end_layer) {
-            vector<PathNode> path;
-            PathNode cur_node = { current.x, current.y, current.layer };
-
-            // Reconstruct path backwards
-            while (!(cur_node.x == start.x && cur_node.y == start.y && cur_node.layer == start_layer)) {
-                path.push_back(cur_node);
-                cur_node = came_from[cur_node.layer][cur_node.y][cur_node.x];
-            }
-            path.push_back({ start.x, start.y, start_layer });
-            reverse(path.begin(), path.end());
-            return path;
+        if (num_sides == 1 && current.x == end.x && current.y == end.y && current.layer == end_layer) {
+            best = current.g;
+            meet = current_key;
+            break;
         }
+        expanded++;
 
         // Movement on same layer
         MetalLayer& layer_info = grid.metal_layers[current.layer];
@@ -1533,85 +4915,384 @@ vector<PathNode> findShortestPath(const Point& start, int start_layer,
             if (layer_info.is_horizontal && dir.y != 0) continue; // Horizontal layer: only x movement
             if (!layer_info.is_horizontal && dir.x != 0) continue; // Vertical layer: only y movement
 
-            Point next_point = { current.x + dir.x, current.y + dir.y };
+            // Walk along the track; without jump this is a single step
+            Point next_point = { current.x, current.y };
+            if (cost.exclusive_pins && !is_free(current.layer, next_point)) break;
+            int steps = 0;
+            while (true) {
+                Point p = { next_point.x + dir.x, next_point.y + dir.y };
 
-            // Check bounds
-            if (next_point.x < 0 || next_point.x >= width ||
-                next_point.y < 0 || next_point.y >= height)
-                continue;
+                // Check bounds
+                if (p.x < 0 || p.x >= width || p.y < 0 || p.y >= height)
+                    break;
 
-            bool is_self = false;
-            for (auto& a : net.pins) {
-                if (a->pos.x == next_point.x && a->pos.y == next_point.y) {
-                    is_self = true;
+                // Check if position is free
+                bool is_self = pin_cells.count(p) > 0;
+                if (!is_free(current.layer, p) && (!is_self || cost.exclusive_pins))
                     break;
-				}
-            }
 
-            // Check if position is free
-            if (!grid.isPositionFree(current.layer, next_point)&&!is_self)
-                continue;
+                // Stay inside the corridor from global routing
+                if (corridor && !corridor->contains(p.x, p.y))
+                    break;
 
-            // Calculate new cost
-            int new_g = current.g + 1;
-            if (new_g < g_score[current.layer][next_point.y][next_point.x]) {
-                g_score[current.layer][next_point.y][next_point.x] = new_g;
-                int h = abs(next_point.x - end.x) + abs(next_point.y - end.y) +
-                    VIA_COST * abs(current.layer - end_layer) + LAYER_COST * abs(current.layer - end_layer);
-                int new_f = new_g + h;
-                open_queue.push({ next_point.x, next_point.y, current.layer, new_g, new_f });
-                came_from[current.layer][next_point.y][next_point.x] =
-                { current.x, current.y, current.layer };
+                next_point = p;
+                steps++;
+                if (!jump || is_self) break;
+                if (layer_info.is_horizontal ? p.x == side.goal.x : p.y == side.goal.y) break;
+                if (num_sides == 2 && sides[1 - s].ws.getG(AStarWorkspace::key(p.x, p.y, current.layer)) != INT_MAX) break;
+                // A via site along the run is expanded in place instead of ending the jump;
+                // if it was already reached more cheaply, that node covers the rest of the run
+                if (via_legal(p, current.layer)) {
+                    int g = current.g + cost.wire * steps;
+                    if (!relax(s, p.x, p.y, current.layer, g, current_key, false)) break;
+                    relaxVias(s, p.x, p.y, current.layer, g, AStarWorkspace::key(p.x, p.y, current.layer));
+                }
             }
+            if (steps == 0) continue;
+
+            relax(s, next_point.x, next_point.y, current.layer, current.g + cost.wire * steps, current_key);
         }
 
-        // Layer switching (vias)
-        for (int layer_offset : {-1, 1}) {
-            int new_layer = current.layer + layer_offset;
-            if (new_layer < 0 || new_layer >= num_layers) continue;
+        relaxVias(s, current.x, current.y, current.layer, current.g, current_key);
+    }
+    route_stats.expanded += expanded;
+    route_stats.pushed += pushed;
+    if (best == INT_MAX) return {}; // No path found
+
+    // Reconstruct path: start .. meet from the forward search, meet .. end from the backward one
+    vector<PathNode> path;
+    uint64_t start_key = AStarWorkspace::key(start.x, start.y, start_layer);
+    for (uint64_t k = meet; ; k = sides[0].ws.getParent(k)) {
+        path.push_back(AStarWorkspace::node(k));
+        if (k == start_key) break;
+    }
+    reverse(path.begin(), path.end());
+    if (num_sides == 2) {
+        uint64_t end_key = AStarWorkspace::key(end.x, end.y, end_layer);
+        for (uint64_t k = meet; k != end_key; ) {
+            k = sides[1].ws.getParent(k);
+            path.push_back(AStarWorkspace::node(k));
+        }
+    }
+    return path;
+}
+
+// Per-thread state of the bit-parallel wavefront search. Bitmaps cover a window
+// of the grid, one row of `words` 64-bit words per layer and row, indexed
+// [layer][row][word]; dist holds the arrival cost per cell, -1 if unreached.
+struct WavefrontWorkspace {
+    int w = 0, h = 0, words = 0, layers = 0;
+    vector<uint64_t> enter, leave, via_to, reached, front, next;
+    vector<int> dist;
+    struct ViaEvent { int t, layer, x, y; };
+    vector<ViaEvent> events;
+
+    void reset(int width, int height, int num_layers) {
+        w = width; h = height; layers = num_layers;
+        words = (w + 63) / 64;
+        size_t n = (size_t)layers * h * words;
+        for (auto* v : { &enter, &leave, &via_to, &reached, &front, &next }) v->assign(n, 0);
+        dist.assign((size_t)layers * h * w, -1);
+        events.clear();
+    }
+    size_t row(int layer, int y) const { return ((size_t)layer * h + y) * words; }
+    bool bit(const vector<uint64_t>& v, int layer, int x, int y) const {
+        return (v[row(layer, y) + (x >> 6)] >> (x & 63)) & 1;
+    }
+    int& at(int layer, int x, int y) { return dist[((size_t)layer * h + y) * w + x]; }
+};
+thread_local WavefrontWorkspace wave_ws;
+
+// 64 cells of a BitGrid row starting at column x (bits past the grid read as 0)
+static uint64_t gridBits(const BitGrid& g, int y, int x) {
+    int k = x >> 6, s = x & 63;
+    uint64_t lo = k < g.words ? g.word(y, k) : 0;
+    if (s == 0) return lo;
+    uint64_t hi = k + 1 < g.words ? g.word(y, k + 1) : 0;
+    return (lo >> s) | (hi << (64 - s));
+}
 
-            // Same position, different layer
-            Point same_point = { current.x, current.y };
+// Index of the lowest set bit; m must be non-zero
+static inline int ctz64(uint64_t m) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(m);
+#else
+    int n = 0;
+    while (!(m & 1)) { m >>= 1; ++n; }
+    return n;
+#endif
+}
 
-            bool is_self = false;
-            for (auto& a : net.pins) {
-                if (a->pos.x == current.x && a->pos.y == current.y) {
-                    is_self = true;
-                    break;
-                }
+// Lee-style wavefront search for pin pairs at most WAVEFRONT_SPAN apart. Each
+// wave advances every layer's frontier by one cell along its preferred
+// direction with word-wide shifts and masks, i.e. 64 cells per operation, inside
+// the pins' bounding box plus WAVE_MARGIN. Vias are events that land cost.via /
+// cost.wire waves later, so arrival order equals path cost and the result is
+// optimal within the window. A cheaper path that leaves the window is not seen,
+// so the result may cost more than an unrestricted A* search. The path is
+// recovered by backtracing the arrival costs. Returns an empty path when the
+// costs are not uniform (via not a multiple of wire) or no path exists inside
+// the window; the caller then runs A*.
+vector<PathNode> wavefrontPath(const Point& start, int start_layer,
+    const Point& end, int end_layer,
+    RoutingGrid& grid, Net& net, const RouteCostModel& cost, const GCellCorridor* corridor) {
+    int num_layers = grid.signal_layers;
+    if (cost.wire <= 0 || cost.via % cost.wire != 0) return {};
+    if (!grid.inBounds(start) || !grid.inBounds(end) || start_layer < 0 || start_layer >= num_layers ||
+        end_layer < 0 || end_layer >= num_layers) return {};
+    if (abs(start.x - end.x) + abs(start.y - end.y) > WAVEFRONT_SPAN) return {};
+    int via_waves = cost.via / cost.wire;
+
+    int x0 = max(0, min(start.x, end.x) - WAVE_MARGIN), x1 = min(grid.width - 1, max(start.x, end.x) + WAVE_MARGIN);
+    int y0 = max(0, min(start.y, end.y) - WAVE_MARGIN), y1 = min(grid.height - 1, max(start.y, end.y) + WAVE_MARGIN);
+    WavefrontWorkspace& ws = wave_ws;
+    ws.reset(x1 - x0 + 1, y1 - y0 + 1, num_layers);
+    int words = ws.words;
+    uint64_t tail = (ws.w & 63) ? (1ULL << (ws.w & 63)) - 1 : ~0ULL; // valid bits of a row's last word
+
+    // Masks: cells a wire may enter, cells a wire may leave, cells a via may land on
+    // self: the net's pin cells; own: the access points reserved for it on their layer
+    vector<uint64_t> self(ws.h * words, 0), via_free(ws.h * words, 0), in_corridor(ws.h * words, ~0ULL);
+    vector<uint64_t> own((size_t)num_layers * ws.h * words, 0);
+    for (auto& pin : net.pins) {
+        Point p = pin->pos;
+        if (p.x < x0 || p.x > x1 || p.y < y0 || p.y > y1) continue;
+        uint64_t bit = 1ULL << ((p.x - x0) & 63);
+        self[(p.y - y0) * words + ((p.x - x0) >> 6)] |= bit;
+        if (pin->layer < num_layers) own[ws.row(pin->layer, p.y - y0) + ((p.x - x0) >> 6)] |= bit;
+    }
+    for (int y = 0; y < ws.h; ++y) {
+        for (int j = 0; j < words; ++j) {
+            via_free[y * words + j] = ~gridBits(grid.via_space, y + y0, x0 + 64 * j);
+            if (!corridor) continue;
+            uint64_t m = 0;
+            for (int b = 0; b < 64 && 64 * j + b < ws.w; ++b) {
+                if (corridor->contains(x0 + 64 * j + b, y + y0)) m |= 1ULL << b;
+            }
+            in_corridor[y * words + j] = m;
+        }
+    }
+    for (int l = 0; l < num_layers; ++l) {
+        for (int y = 0; y < ws.h; ++y) {
+            for (int j = 0; j < words; ++j) {
+                size_t i = ws.row(l, y) + j, r = y * words + j;
+                uint64_t free_bits = ~gridBits(grid.metal_layers[l].used, y + y0, x0 + 64 * j) | own[i];
+                uint64_t valid = j == words - 1 ? tail : ~0ULL;
+                ws.enter[i] = (cost.exclusive_pins ? free_bits : (free_bits | self[r])) & in_corridor[r] & valid;
+                ws.leave[i] = (cost.exclusive_pins ? free_bits : ~0ULL) & valid;
+                ws.via_to[i] = (via_free[r] | self[r]) & (free_bits | self[r]) & valid;
             }
+        }
+    }
 
-            // Check via availability (via space)
-            if (!grid.isViaFree(same_point) && !is_self)
+    auto reach = [&](int l, int x, int y, int t) {
+        ws.at(l, x, y) = t;
+        ws.reached[ws.row(l, y) + (x >> 6)] |= 1ULL << (x & 63);
+        ws.front[ws.row(l, y) + (x >> 6)] |= 1ULL << (x & 63);
+    };
+    int sx = start.x - x0, sy = start.y - y0, ex = end.x - x0, ey = end.y - y0;
+    reach(start_layer, sx, sy, 0);
+    size_t head = 0;
+    int t = 0;
+    while (ws.at(end_layer, ex, ey) < 0) {
+        // Vias landing in this wave join the frontier
+        for (; head < ws.events.size() && ws.events[head].t == t; ++head) {
+            auto e = ws.events[head];
+            if (ws.at(e.layer, e.x, e.y) < 0) reach(e.layer, e.x, e.y, t);
+        }
+        if (ws.at(end_layer, ex, ey) >= 0) break;
+
+        bool active = false;
+        for (int l = 0; l < num_layers; ++l) {
+            bool horizontal = grid.metal_layers[l].is_horizontal;
+            for (int y = 0; y < ws.h; ++y) {
+                const uint64_t* f = &ws.front[ws.row(l, y)];
+                for (int j = 0; j < words; ++j) {
+                    // Schedule vias from the cells reached in this wave
+                    for (uint64_t m = f[j]; m; m &= m - 1) {
+                        int x = 64 * j + ctz64(m);
+                        for (int nl : { l - 1, l + 1 }) {
+                            if (nl < 0 || nl >= num_layers || ws.bit(ws.reached, nl, x, y) || !ws.bit(ws.via_to, nl, x, y)) continue;
+                            ws.events.push_back({ t + via_waves, nl, x, y });
+                        }
+                    }
+                }
+                // One planar step along the preferred direction
+                uint64_t* n = &ws.next[ws.row(l, y)];
+                const uint64_t* en = &ws.enter[ws.row(l, y)];
+                const uint64_t* rc = &ws.reached[ws.row(l, y)];
+                const uint64_t* lv = &ws.leave[ws.row(l, y)];
+                for (int j = 0; j < words; ++j) {
+                    uint64_t grow;
+                    if (horizontal) {
+                        uint64_t cur = f[j] & lv[j];
+                        uint64_t below = j > 0 ? (f[j - 1] & lv[j - 1]) >> 63 : 0;
+                        uint64_t above = j + 1 < words ? (f[j + 1] & lv[j + 1]) << 63 : 0;
+                        grow = (cur << 1) | below | (cur >> 1) | above;
+                    }
+                    else {
+                        grow = 0;
+                        if (y > 0) grow |= ws.front[ws.row(l, y - 1) + j] & ws.leave[ws.row(l, y - 1) + j];
+                        if (y + 1 < ws.h) grow |= ws.front[ws.row(l, y + 1) + j] & ws.leave[ws.row(l, y + 1) + j];
+                    }
+                    n[j] = grow & en[j] & ~rc[j];
+                    if (n[j]) active = true;
+                }
+            }
+        }
+        // Record arrival costs of the new frontier
+        ws.front.swap(ws.next);
+        for (int l = 0; l < num_layers; ++l) {
+            for (int y = 0; y < ws.h; ++y) {
+                for (int j = 0; j < words; ++j) {
+                    size_t i = ws.row(l, y) + j;
+                    ws.reached[i] |= ws.front[i];
+                    for (uint64_t m = ws.front[i]; m; m &= m - 1) ws.at(l, 64 * j + ctz64(m), y) = t + 1;
+                }
+            }
+        }
+        t++;
+        if (!active) {
+            if (head == ws.events.size()) return {};
+            t = ws.events[head].t; // nothing moves until the next via lands
+        }
+    }
+    route_stats.waves++;
+
+    // Backtrace: a planar neighbour one wave earlier, else a via via_waves earlier
+    vector<PathNode> back;
+    int x = ex, y = ey, l = end_layer;
+    while (true) {
+        back.push_back({ x + x0, y + y0, l });
+        int d = ws.at(l, x, y);
+        if (d == 0) break;
+        bool moved = false;
+        if (ws.bit(ws.enter, l, x, y)) {
+            bool horizontal = grid.metal_layers[l].is_horizontal;
+            for (int step : { -1, 1 }) {
+                int px = horizontal ? x + step : x, py = horizontal ? y : y + step;
+                if (px < 0 || px >= ws.w || py < 0 || py >= ws.h) continue;
+                if (ws.at(l, px, py) != d - 1 || !ws.bit(ws.leave, l, px, py)) continue;
+                x = px; y = py;
+                moved = true;
+                break;
+            }
+        }
+        for (int nl : { l - 1, l + 1 }) {
+            if (moved || nl < 0 || nl >= num_layers || ws.at(nl, x, y) != d - via_waves || !ws.bit(ws.via_to, l, x, y)) continue;
+            l = nl;
+            moved = true;
+        }
+        if (!moved) return {};
+    }
+    // Merge straight runs into single segments
+    vector<PathNode> path;
+    for (int i = back.size() - 1; i >= 0; --i) {
+        const PathNode& p = back[i];
+        if (path.size() >= 2) {
+            const PathNode& a = path[path.size() - 2];
+            const PathNode& b = path.back();
+            if (a.layer == b.layer && b.layer == p.layer && ((a.x == b.x && b.x == p.x) || (a.y == b.y && b.y == p.y))) {
+                path.back() = p;
                 continue;
+            }
+        }
+        path.push_back(p);
+    }
+    return path;
+}
 
-            // Check if new layer position is free
-            if (!grid.isPositionFree(new_layer, same_point)&& !is_self)
-                continue;
+vector<PathNode> findShortestPath(const Point& start, int start_layer,
+    const Point& end, int end_layer,
+    RoutingGrid& grid, Net& net, const RouteCostModel& cost = route_cost) {
+    // Search only along the global route between the two pins
+    GCellCorridor pair_corridor;
+    const GCellCorridor* corridor = nullptr;
+    if (net.corridor) {
+        pair_corridor = net.corridor->between(start, end);
+        corridor = &pair_corridor;
+    }
+    // Short pairs try the bit-parallel wavefront first
+    if (WAVEFRONT_SPAN > 0) {
+        auto path = wavefrontPath(start, start_layer, end, end_layer, grid, net, cost, corridor);
+        if (!path.empty()) return path;
+    }
+    auto path = searchPath(start, start_layer, end, end_layer, grid, net, TRACK_JUMP, cost, corridor);
+    // The corridor may be too tight once other nets are marked; widen to the whole grid
+    if (path.empty() && corridor) path = searchPath(start, start_layer, end, end_layer, grid, net, TRACK_JUMP, cost, nullptr);
+    if (path.empty()) cout << "||";
+    return path;
+}
+
+// 重新布线网络，避开障碍
+// 把一条路径的线段和过孔加入线网
+void appendPath(Net& net, const vector<PathNode>& path, unordered_set<Point, PointHash>& vias_set) {
+    for (size_t j = 1; j < path.size(); ++j) {
+        const auto& prev = path[j - 1];
+        const auto& curr = path[j];
+
+        // 添加线段（如果位置发生变化）
+        if (prev.x != curr.x || prev.y != curr.y) {
+            Segment seg;
+            seg.start = { prev.x, prev.y };
+            seg.end = { curr.x, curr.y };
+            seg.layer = prev.layer; // 线段属于起始点的层
+            net.segments.push_back(seg);
+        }
 
-            // Calculate new cost (via cost)
-            int new_g = current.g + VIA_COST;
-            if (new_g < g_score[new_layer][same_point.y][same_point.x]) {
-                g_score[new_layer][same_point.y][same_point.x] = new_g;
-                int h = abs(same_point.x - end.x) + abs(same_point.y - end.y) + VIA_COST * abs(new_layer - end_layer)
-                    + LAYER_COST * max(new_layer - end_layer, current.layer - end_layer);
-                int new_f = new_g + h;
-                open_queue.push({ same_point.x, same_point.y, new_layer, new_g, new_f });
-                came_from[new_layer][same_point.y][same_point.x] =
-                { current.x, current.y, current.layer };
+        // 添加过孔（如果层发生变化）
+        if (prev.layer != curr.layer) {
+            Point via_pos = { prev.x, prev.y }; // 或 curr.x, curr.y 相同
+            if (vias_set.find(via_pos) == vias_set.end()) {
+                net.vias.push_back(via_pos);
+                vias_set.insert(via_pos);
             }
         }
     }
-    cout << "||";
-    return {}; // No path found
 }
 
-// 重新布线网络，避开障碍
-void reRoute(Net& net, RoutingGrid& grid) {
+// 按斯坦纳树拓扑布线：每条树边只搜索一次，斯坦纳点沿用已连上那一端的层，
+// 该层被占用（如落在其他线网的引脚上）时换到空闲层；
+// 连不上的节点跳过，其子节点改从父节点出发连接
+void routeSteinerTree(Net& net, RoutingGrid& grid, const RouteCostModel& cost) {
+    if (!net.topology) {
+        vector<Point> points;
+        for (const auto& pin : net.pins) points.push_back(pin->pos);
+        net.topology = make_shared<SteinerTree>(buildSteinerTree(points));
+    }
+    const SteinerTree& tree = *net.topology;
+    vector<vector<int>> children(tree.nodes.size());
+    for (auto [u, v] : tree.edges) children[u].push_back(v);
+    vector<int> layer(tree.nodes.size(), 0);
+    for (int i = 0; i < tree.pin_count; ++i) layer[i] = net.pins[i]->layer;
+
+    unordered_set<Point, PointHash> vias_set;
+    vector<pair<int, int>> queue;
+    for (int v : children[0]) queue.push_back({ 0, v });
+    for (size_t i = 0; i < queue.size(); ++i) {
+        auto [u, v] = queue[i];
+        if (v >= tree.pin_count) {
+            layer[v] = layer[u];
+            for (int l = 0; l < grid.signal_layers && !grid.isPositionFree(layer[v], tree.nodes[v]); ++l) layer[v] = l;
+        }
+        bool blocked = v >= tree.pin_count && !grid.isPositionFree(layer[v], tree.nodes[v]);
+        auto path = blocked ? vector<PathNode>() : findShortestPath(tree.nodes[u], layer[u], tree.nodes[v], layer[v], grid, net, cost);
+        int from = v;
+        if (!path.empty()) appendPath(net, path, vias_set);
+        else from = u;
+        for (int w : children[v]) queue.push_back({ from, w });
+    }
+}
+
+void reRoute(Net& net, RoutingGrid& grid, const RouteCostModel& cost) {
     net.segments.clear();
     net.vias.clear();
 
     if (net.pins.size() <= 1) return;
+    if (STEINER_PINS > 0 && (int)net.pins.size() >= STEINER_PINS) {
+        routeSteinerTree(net, grid, cost);
+        return;
+    }
 
     // 收集引脚位置和层
     vector<Point> pin_positions;
@@ -1632,23 +5313,14 @@ void reRoute(Net& net, RoutingGrid& grid) {
                 pin_positions[i], pin_layers[i],
                 pin_positions[j], pin_layers[j],
                 grid,
-                net
+                net,
+                cost
             );
             if (!path.empty()) {
                 paths[i][j] = path;
                 paths[j][i] = path;
-                // 计算路径长度（实际代价）
-                int dist = 0;
-                for (size_t k = 1; k < path.size(); ++k) {
-                    // 移动代价
-                    if (path[k].x != path[k - 1].x || path[k].y != path[k - 1].y) {
-                        dist += 1;
-                    }
-                    // 过孔代价
-                    else if (path[k].layer != path[k - 1].layer) {
-                        dist += 5;
-                    }
-                }
+                // 计算路径长度（与搜索使用同一代价模型）
+                int dist = cost.pathCost(path);
                 distances[i][j] = dist;
                 distances[j][i] = dist;
             }
@@ -1689,37 +5361,110 @@ void reRoute(Net& net, RoutingGrid& grid) {
 
         int u = parent[i];
         int v = i;
-        const auto& path = paths[u][v];
-
-        // 添加路径中的线段和过孔
-        for (size_t j = 1; j < path.size(); ++j) {
-            const auto& prev = path[j - 1];
-            const auto& curr = path[j];
-
-            // 添加线段（如果位置发生变化）
-            if (prev.x != curr.x || prev.y != curr.y) {
-                Segment seg;
-                seg.start = { prev.x, prev.y };
-                seg.end = { curr.x, curr.y };
-                seg.layer = prev.layer; // 线段属于起始点的层
-                net.segments.push_back(seg);
-            }
-
-            // 添加过孔（如果层发生变化）
-            if (prev.layer != curr.layer) {
-                Point via_pos = { prev.x, prev.y }; // 或 curr.x, curr.y 相同
-                if (vias_set.find(via_pos) == vias_set.end()) {
-                    net.vias.push_back(via_pos);
-                    vias_set.insert(via_pos);
+        appendPath(net, paths[u][v], vias_set);
+    }
+    // cout << ">";
+}
+
+// 线网引脚的包围盒
+struct NetBBox {
+    int min_x, min_y, max_x, max_y;
+    bool overlaps(const NetBBox& o, int margin) const {
+        return min_x - margin <= o.max_x && o.min_x - margin <= max_x &&
+            min_y - margin <= o.max_y && o.min_y - margin <= max_y;
+    }
+};
+
+NetBBox pinBBox(const Net& net) {
+    NetBBox b = { INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+    for (const auto& pin : net.pins) {
+        b.min_x = min(b.min_x, pin->pos.x);
+        b.min_y = min(b.min_y, pin->pos.y);
+        b.max_x = max(b.max_x, pin->pos.x);
+        b.max_y = max(b.max_y, pin->pos.y);
+    }
+    return b;
+}
+
+// 并行拆线重布：每轮按固定顺序挑出冲突线网，网格恢复为只含子模块与引脚的
+// 底图并标记保留的线网；待重布线网按包围盒互不相交分批，同批并行布线后按
+// 序号依次标记。结果只取决于线网顺序，与线程数和调度无关。返回是否仍有冲突
+bool rerouteConflictingNetsParallel(SubModuleNode& module, int maxIterations) {
+    const int margin = 2; // 包围盒间距，避免相邻批内线网贴边走线
+    RoutingGrid base = module.routing_grid;
+    auto& nets = module.nets;
+    int n = nets.size();
+    vector<NetBBox> boxes(n);
+    for (int i = 0; i < n; ++i) boxes[i] = pinBBox(*nets[i]);
+    vector<int> redo_count(n, 0);
+    // 待重布线网自身不在网格上，引脚格点若被占用说明有别的线网在此终止
+    RouteCostModel exclusive = route_cost;
+    exclusive.exclusive_pins = true;
+
+    bool conflictFound = true;
+    while (conflictFound && maxIterations-- > 0) {
+        cout << "[";
+        conflictFound = false;
+        // 冲突对中重布非固定的一条：优先重布次数少的，相同则取序号靠后的，
+        // 这样反复重布仍绕不开的线网会换成让对方让路
+        vector<char> redo(n, 0);
+        for (int i = 0; i < n; i++) {
+            for (int j = i + 1; j < n; j++) {
+                if (nets[i]->fixed && nets[j]->fixed) continue;
+                if (redo[i] || redo[j]) continue;
+                if (checkNetOverlap(*nets[i], *nets[j])) {
+                    conflictFound = true;
+                    bool pick_i = nets[j]->fixed || (!nets[i]->fixed && redo_count[i] < redo_count[j]);
+                    redo[pick_i ? i : j] = 1;
+                }
+            }
+        }
+        for (int i = 0; i < n; ++i) redo_count[i] += redo[i];
+        if (!conflictFound) break;
+
+        module.routing_grid = base;
+        for (int i = 0; i < n; ++i) {
+            if (!redo[i]) markNetOnGrid(*nets[i], module.routing_grid);
+        }
+        vector<int> pending;
+        for (int i = 0; i < n; ++i) {
+            if (redo[i]) pending.push_back(i);
+        }
+        while (!pending.empty()) {
+            vector<int> batch, rest;
+            for (int i : pending) {
+                bool disjoint = true;
+                for (int b : batch) {
+                    if (boxes[i].overlaps(boxes[b], margin)) { disjoint = false; break; }
                 }
+                (disjoint ? batch : rest).push_back(i);
+            }
+            routePool().parallelFor(batch.size(), [&](int k) {
+                reRoute(*nets[batch[k]], module.routing_grid, exclusive);
+            });
+            for (int i : batch) {
+                markNetOnGrid(*nets[i], module.routing_grid);
+                cout << "=";
             }
+            pending.swap(rest);
         }
+        cout << "]\n";
     }
-    // cout << ">";
+    module.routing_grid = base;
+    // 最后一轮重布后的结果还需再检查一次
+    if (conflictFound) {
+        conflictFound = false;
+        for (int i = 0; i < n && !conflictFound; i++) {
+            for (int j = i + 1; j < n; j++) {
+                if (checkNetOverlap(*nets[i], *nets[j])) { conflictFound = true; break; }
+            }
+        }
+    }
+    return conflictFound;
 }
 
 // 拆线重排主函数
-void rerouteConflictingNets(SubModuleNode& module) {
+bool rerouteConflictingNets(SubModuleNode& module) {
     bool conflictFound = true;
     int maxIterations = 10;
     cout << "拆线重布" << module.module_name << endl;
@@ -1745,6 +5490,11 @@ void rerouteConflictingNets(SubModuleNode& module) {
         return lenA < lenB;
         });
 
+    // 并行模式先分批重布，剩下的冲突（如共用引脚格点）交给逐对重布收尾
+    if (ROUTE_THREADS > 1) {
+        conflictFound = rerouteConflictingNetsParallel(module, maxIterations / 2);
+        maxIterations -= maxIterations / 2;
+    }
     while (conflictFound && maxIterations-- > 0) {
         cout << "[";
         conflictFound = false;
@@ -1753,13 +5503,17 @@ void rerouteConflictingNets(SubModuleNode& module) {
                 Net& net1 = *module.nets[i];
                 Net& net2 = *module.nets[j];
 
+                if (net1.fixed && net2.fixed) continue;
                 if (checkNetOverlap(net1, net2)) {
                     conflictFound = true;
-                    markNetOnGrid(net1, module.routing_grid);
-                    // 重新布线net2
+                    // 固定的线网不拆，重布另一条
+                    Net& keep = net2.fixed ? net2 : net1;
+                    Net& redo = net2.fixed ? net1 : net2;
+                    markNetOnGrid(keep, module.routing_grid);
+                    // 重新布线
                     if (!component_sizes.count(module.module_name))cout << "不存在" << module.module_name << endl;
-                    reRoute(net2, module.routing_grid);
-                    markNetOnGrid(net2, module.routing_grid);
+                    reRoute(redo, module.routing_grid);
+                    markNetOnGrid(redo, module.routing_grid);
                     if (checkNetOverlap(net1, net2))cout << "x";
                     else cout << "=";
                 }
@@ -1769,6 +5523,7 @@ void rerouteConflictingNets(SubModuleNode& module) {
     }
     if (conflictFound) cout << "无法实现无重叠，退出" << module.name + "的布线" << endl;
     else cout << "\n成功布线！" << endl;
+    return !conflictFound;
 }
 
 int main(int argc, char* argv[]) {
@@ -1776,6 +5531,11 @@ int main(int argc, char* argv[]) {
     string module_name = "adder4";             // 模块名
     string layout_output = "Layout_after.json"; // 默认布局输出文件
     string route_output = "Route_after.json";   // 默认布线输出文件
+    string geometry_output = "";                // 展平几何输出文件（为空则不导出）
+    string def_output = "";                     // DEF输出文件（为空则不导出）
+    string gds_output = "";                     // GDSII输出文件（为空则不导出）
+    string eco_layout_file = "";                // ECO模式下前次的布局结果
+    string eco_route_file = "";                 // ECO模式下前次的布线结果
     bool help_flag = false;
 
     // 解析命令行参数
@@ -1809,6 +5569,106 @@ int main(int argc, char* argv[]) {
             layout_output = argv[++i];
         } else if (arg == "-r" && i + 1 < argc) {
             route_output = argv[++i];
+        } else if (arg == "-o" && i + 1 < argc) {
+            geometry_output = argv[++i];
+        } else if (arg == "-D" && i + 1 < argc) {
+            def_output = argv[++i];
+        } else if (arg == "-g" && i + 1 < argc) {
+            gds_output = argv[++i];
+        } else if (arg == "-e" && i + 1 < argc) {
+            eco_layout_file = argv[++i];
+        } else if (arg == "-E" && i + 1 < argc) {
+            eco_route_file = argv[++i];
+        } else if (arg == "-w" && i + 1 < argc) {
+            try {
+                ASTAR_WEIGHT = stod(argv[++i]);
+                if (ASTAR_WEIGHT < 1) { cerr << "错误：启发式系数不能小于1\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-w参数\n"; return 1; }
+        } else if (arg == "-b") {
+            BIDIR_ASTAR = true;
+        } else if (arg == "-p" && i + 1 < argc) {
+            try {
+                ROUTE_THREADS = stoi(argv[++i]);
+                if (ROUTE_THREADS <= 0) { cerr << "错误：线程数必须为正数\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-p参数\n"; return 1; }
+        } else if (arg == "-s" && i + 1 < argc) {
+            try {
+                RANDOM_SEED = stoll(argv[++i]);
+                if (RANDOM_SEED < 0) { cerr << "错误：随机种子不能为负数\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-s参数\n"; return 1; }
+        } else if (arg == "-G" && i + 1 < argc) {
+            try {
+                GCELL_SIZE = stoi(argv[++i]);
+                if (GCELL_SIZE < 0) { cerr << "错误：粗格边长不能为负数\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-G参数\n"; return 1; }
+        } else if (arg == "-u" && i + 1 < argc) {
+            try {
+                CONGESTION_WEIGHT = stod(argv[++i]);
+                if (CONGESTION_WEIGHT < 0) { cerr << "错误：拥挤度权重不能为负数\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-u参数\n"; return 1; }
+        } else if (arg == "-R" && i + 1 < argc) {
+            try {
+                REPLACE_RETRIES = stoi(argv[++i]);
+                if (REPLACE_RETRIES < 0) { cerr << "错误：重新布局次数不能为负数\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-R参数\n"; return 1; }
+        } else if (arg == "-a" && i + 1 < argc) {
+            try {
+                SA_KERNEL = stoi(argv[++i]);
+                if (SA_KERNEL != 0 && SA_KERNEL != 1) { cerr << "错误：退火内核只能为0或1\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-a参数\n"; return 1; }
+        } else if (arg == "-B" && i + 1 < argc) {
+            try {
+                SA_BATCH = stoi(argv[++i]);
+                if (SA_BATCH < 0) { cerr << "错误：批量大小不能为负数\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-B参数\n"; return 1; }
+        } else if (arg == "-P" && i + 1 < argc) {
+            try {
+                POWER_LAYERS = stoi(argv[++i]);
+                // 电源轨道按水平/竖直一对层生成，奇数层数会空出一层
+                if (POWER_LAYERS != 0 && (POWER_LAYERS < 2 || POWER_LAYERS % 2 != 0 || POWER_LAYERS >= MAX_METAL_LAYER)) {
+                    cerr << "错误：电源层数须为0，或不少于2的偶数且小于金属层数" << MAX_METAL_LAYER << "\n";
+                    return 1;
+                }
+            } catch (...) { cerr << "错误：无效的-P参数\n"; return 1; }
+        } else if (arg == "-T" && i + 1 < argc) {
+            try {
+                STEINER_PINS = stoi(argv[++i]);
+                if (STEINER_PINS < 0) { cerr << "错误：斯坦纳树引脚数不能为负数\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-T参数\n"; return 1; }
+        } else if (arg == "-W" && i + 1 < argc) {
+            try {
+                WAVEFRONT_SPAN = stoi(argv[++i]);
+                if (WAVEFRONT_SPAN < 0) { cerr << "错误：波前搜索距离不能为负数\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-W参数\n"; return 1; }
+        } else if (arg == "-L" && i + 1 < argc) {
+            try {
+                MULTILEVEL_LEVELS = stoi(argv[++i]);
+                if (MULTILEVEL_LEVELS < 0) { cerr << "错误：粗化层数不能为负数\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-L参数\n"; return 1; }
+        } else if (arg == "-S" && i + 1 < argc) {
+            try {
+                CLUSTER_MAX = stoi(argv[++i]);
+                if (CLUSTER_MAX < 2) { cerr << "错误：簇大小不能小于2\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-S参数\n"; return 1; }
+        } else if (arg == "-k" && i + 1 < argc) {
+            try {
+                PARTITION_SIZE = stoi(argv[++i]);
+                if (PARTITION_SIZE < 0) { cerr << "错误：切分规模不能为负数\n"; return 1; }
+            } catch (...) { cerr << "错误：无效的-k参数\n"; return 1; }
+        } else if (arg == "-M" && i + 1 < argc) {
+            try {
+                long long mb = stoll(argv[++i]);
+                if (mb < 0) { cerr << "错误：内存预算不能为负数\n"; return 1; }
+                MEMORY_BUDGET_MB = mb;
+            } catch (...) { cerr << "错误：无效的-M参数\n"; return 1; }
+        } else if (arg == "-C") {
+            CHECK_ROUTE = true;
+        } else if (arg == "-A") {
+            ARRAY_PLACE = true;
+        } else if (arg == "-j") {
+            TRACK_JUMP = true;
+        } else if (arg == "-d" && i + 1 < argc) {
+            CACHE_DIR = argv[++i];
         } else if (arg == "-h") {
             help_flag = true;
         } else {
@@ -1816,6 +5676,10 @@ int main(int argc, char* argv[]) {
             return 1;
         }
     }
+    if (SA_KERNEL == 1 && SA_BATCH > 0) {
+        cerr << "错误：定点退火内核(-a 1)不支持批量退火(-B)\n";
+        return 1;
+    }
 
     // 显示帮助信息
     if (help_flag) {
@@ -1848,13 +5712,65 @@ int main(int argc, char* argv[]) {
     root->name = module_name;
     root->module_name = module_name;
 
+    // 读取前次结果，进入ECO增量模式
+    if (!eco_layout_file.empty()) {
+        ifstream prev_layout(eco_layout_file);
+        if (!prev_layout.is_open()) {
+            cerr << "无法打开文件: " << eco_layout_file << endl;
+            return 1;
+        }
+        prev_layout >> eco_layout_doc;
+        if (!eco_route_file.empty()) {
+            ifstream prev_route(eco_route_file);
+            if (!prev_route.is_open()) {
+                cerr << "无法打开文件: " << eco_route_file << endl;
+                return 1;
+            }
+            prev_route >> eco_route_doc;
+        }
+        if (!eco_layout_doc.contains(module_name)) {
+            cerr << "前次布局中不存在模块: " << module_name << endl;
+            return 1;
+        }
+        const json* route_root = eco_route_doc.contains(module_name) ? &eco_route_doc[module_name] : nullptr;
+        collectEcoModules(eco_layout_doc[module_name], route_root);
+        cout << "ECO模式：载入前次结果中的" << eco_db.size() << "种模块" << endl;
+    }
+
+    if (MEMORY_BUDGET_MB > 0) SPILL_DIR = route_output + ".spill";
+    route_cost.via = VIA_COST;
+    route_cost.weight = ASTAR_WEIGHT;
+    route_cost.bidirectional = BIDIR_ASTAR;
+
     std::cout << "处理文件中……" << endl;
+    partitionFlatModules(j);
     root = JsonToAST(j, module_name);
     cout << "布局元件中……" << endl;
     layout(root);
-    outputLayoutToJson(*root, layout_output);
     buildNets(root);
+    for (int attempt = 1; attempt <= REPLACE_RETRIES && !failed_modules.empty(); ++attempt) {
+        cout << failed_modules.size() << "种模块布线失败，加宽冲突处元件后重新布局（第" << attempt << "次）" << endl;
+        if (CONGESTION_WEIGHT <= 0) CONGESTION_WEIGHT = 1.0; // 重新布局时打开拥挤度代价
+        replaced_modules.clear();
+        invalidateFailedModules(*root);
+        failed_modules.clear();
+        layout(root);
+        buildNets(root);
+    }
+    outputLayoutToJson(*root, layout_output); // 布线失败时可能重新布局，布线后再输出
     outputRouteToJson(*root, route_output);
+    if (!geometry_output.empty()) outputGeometry(*root, geometry_output);
+    if (!def_output.empty()) outputDef(*root, def_output);
+    if (!gds_output.empty()) outputGds(*root, gds_output);
+    if (MEMORY_BUDGET_MB > 0) {
+        cout << "布线数据常驻内存峰值" << resident_peak / 1024 << "KB，溢出" << spilled_count << "次" << endl;
+        error_code ec;
+        filesystem::remove_all(SPILL_DIR, ec);
+    }
+    cout << "A*搜索共" << route_stats.searches << "次，扩展节点" << route_stats.expanded
+        << "个，入堆" << route_stats.pushed << "个" << endl;
+    if (WAVEFRONT_SPAN > 0) cout << "波前搜索找到路径" << route_stats.waves << "次" << endl;
+    if (CHECK_ROUTE) cout << "布线检查共" << drc_violations << "处违例" << endl;
     return 0;
 }
 
@@ -1869,5 +5785,30 @@ void print_help() {
     cout << "-i <温度>     设置初始退火温度 (默认: 100000.0)\n";
     cout << "-l <文件名>   设置布局结果输出文件 (默认: Layout_after.json)\n";
     cout << "-r <文件名>   设置布线结果输出文件 (默认: Route_after.json)\n";
+    cout << "-o <文件名>   导出展平的绝对坐标几何（元件、线段、过孔），.bin结尾为二进制，否则为JSON (默认: 不导出)\n";
+    cout << "-D <文件名>   导出DEF（元件、顶层端口、展平后的布线） (默认: 不导出)\n";
+    cout << "-g <文件名>   导出GDSII流（元件、金属线、过孔均为矩形） (默认: 不导出)\n";
+    cout << "-e <文件名>   ECO增量模式：指定前次布局结果 (默认: 不使用)\n";
+    cout << "-E <文件名>   ECO增量模式：指定前次布线结果，与-e一起使用 (默认: 不使用)\n";
+    cout << "-w <系数>     A*启发式放大系数，大于1时为加权A* (默认: 1.0)\n";
+    cout << "-b            使用双向A*搜索 (默认: 单向)\n";
+    cout << "-p <线程数>   线程数，大于1时分批并行拆线重布，批量退火时并行评估 (默认: 1)\n";
+    cout << "-a <内核>     退火内核：0为浮点成本，1为定点整数成本加xoshiro随机数，不与-B同用 (默认: 0)\n";
+    cout << "-B <数量>     批量退火：每批提议该数量的移动，评估后提交互不冲突的 (默认: 0 逐个评估)\n";
+    cout << "-s <种子>     随机种子，相同种子结果可复现 (默认: 随机)\n";
+    cout << "-G <边长>     先在该边长的粗格上做全局布线，详细布线限制在走廊内 (默认: 0 不使用)\n";
+    cout << "-u <权重>     退火时加入拥挤度(RUDY)溢出成本 (默认: 0 不考虑)\n";
+    cout << "-R <次数>     布线失败后加宽冲突处元件并重新布局的最多次数 (默认: 0)\n";
+    cout << "-P <层数>     顶部若干（偶数）金属层留给电源/时钟网络，VCC、GND、CLK直接生成轨道 (默认: 0 按信号线布线)\n";
+    cout << "-T <引脚数>   引脚数不少于该值的线网按斯坦纳树拓扑布线和估计线长 (默认: 4，0为不使用)\n";
+    cout << "-W <距离>     两端距离不超过该值的引脚对先用按位波前(Lee)搜索，找不到再用A* (默认: 0 不使用)\n";
+    cout << "-A            识别阵列/位片，按刚性宏整体布局 (默认: 逐个元件布局)\n";
+    cout << "-L <层数>     多级布局：按连接粗化该层数后布局，再逐层展开细化 (默认: 0 不使用)\n";
+    cout << "-S <数量>     多级布局中一个簇最多包含的元件数 (默认: 8)\n";
+    cout << "-k <数量>     MOS数超过该值的平面模块按最小割自动切分为子模块 (默认: 0 不切分)\n";
+    cout << "-j            布线时沿轨道整段跳跃扩展 (默认: 逐格扩展)\n";
+    cout << "-d <目录>     启用布局布线缓存，缓存存放于该目录 (默认: 不使用)\n";
+    cout << "-C            每个模块布线后检查短路、开路、越界和过孔冲突 (默认: 不检查)\n";
+    cout << "-M <MB>       布线数据常驻内存上限，超出时把已完成子模块的布线溢出到磁盘 (默认: 0 不限制)\n";
     cout << "-h            显示此帮助信息\n";
 }
\ No newline at end of file
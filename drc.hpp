@@ -0,0 +1,257 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <tuple>
+#include "json.hpp"
+
+// 布线结果的设计规则/连通性检查。一个模块的线段、过孔和引脚按层建立扫描线索引，
+// 求出所有相交的形状对：同一线网的并入并查集用于判断开路，不同线网的记为短路或过孔冲突。
+// 过孔只记录位置，不知道连接哪两层，所以只与同线网的形状相连、与其他线网的过孔冲突，
+// 不与其他线网的导线比较
+// 各层互不相关，可并行；时间约为O(形状数·log(形状数) + 相交对数)
+namespace drc {
+
+enum ShapeKind { WIRE, VIA, PIN };
+
+// 规整为x1<=x2、y1<=y2，覆盖两端之间的所有格点；过孔和引脚是单点
+struct Shape {
+    int net;
+    int layer;
+    int x1, y1, x2, y2;
+    ShapeKind kind;
+};
+
+// 一个模块的布线。边界为[x0, x0+width)x[y0, y0+height)，宽高或层数为0表示不检查该项
+struct Layout {
+    std::string name;
+    int x0 = 0, y0 = 0, width = 0, height = 0, layers = 0;
+    std::vector<std::string> nets;
+    std::vector<Shape> shapes;      // 线段、过孔、引脚（过孔不区分层，连通所在点的所有层）
+    long long off_grid = 0;         // 载入时发现的非整数坐标或斜线段
+
+    int addNet(const std::string& net_name) {
+        nets.push_back(net_name);
+        return nets.size() - 1;
+    }
+    void addSegment(int net, int layer, int x1, int y1, int x2, int y2) {
+        if (x1 != x2 && y1 != y2) {
+            ++off_grid;
+            return;
+        }
+        shapes.push_back({ net, layer, std::min(x1, x2), std::min(y1, y2), std::max(x1, x2), std::max(y1, y2), WIRE });
+    }
+    void addVia(int net, int x, int y) { shapes.push_back({ net, -1, x, y, x, y, VIA }); }
+    void addPin(int net, int layer, int x, int y) { shapes.push_back({ net, layer, x, y, x, y, PIN }); }
+};
+
+struct Report {
+    long long shorts = 0;           // 不同线网的导线/引脚重叠（含压在其他线网引脚上的导线）
+    long long opens = 0;            // 引脚不全连通的线网
+    long long off_grid = 0;         // 非整数坐标或斜线段
+    long long out_of_bounds = 0;    // 超出模块边界或层数的形状
+    long long via_conflicts = 0;    // 不同线网的过孔在同一点
+    std::vector<std::string> examples;  // 前若干条违例的描述
+    bool clean() const { return shorts + opens + off_grid + out_of_bounds + via_conflicts == 0; }
+};
+
+const int MAX_EXAMPLES = 20;
+
+// 相交的形状对及一个交点
+struct Hit {
+    int a, b;
+    int layer, x, y;
+};
+
+// 一层上所有两两相交的形状：同行横线按起点排序后扫描，同列竖线同理，
+// 横竖交叉按x扫描，活动横线按y放在有序表中做区间查询
+inline std::vector<Hit> sweepLayer(const std::vector<Shape>& all, const std::vector<int>& ids, int layer) {
+    std::vector<Hit> hits;
+    std::map<int, std::vector<int>> rows, cols;
+    for (int id : ids) {
+        const Shape& s = all[id];
+        if (s.y1 == s.y2) rows[s.y1].push_back(id);
+        else cols[s.x1].push_back(id);
+    }
+    // 共线的区间：活动集合按终点排序，先删掉已结束的，剩下的都与当前区间重叠
+    auto collinear = [&](std::vector<int>& line, bool horizontal) {
+        auto lo = [&](int id) { return horizontal ? all[id].x1 : all[id].y1; };
+        auto hi = [&](int id) { return horizontal ? all[id].x2 : all[id].y2; };
+        std::sort(line.begin(), line.end(), [&](int a, int b) { return lo(a) < lo(b); });
+        std::multiset<std::pair<int, int>> active;
+        for (int id : line) {
+            while (!active.empty() && active.begin()->first < lo(id)) active.erase(active.begin());
+            for (const auto& [end, other] : active) {
+                const Shape& s = all[id];
+                hits.push_back({ other, id, layer, horizontal ? lo(id) : s.x1, horizontal ? s.y1 : lo(id) });
+            }
+            active.insert({ hi(id), id });
+        }
+    };
+    for (auto& [y, line] : rows) collinear(line, true);
+    for (auto& [x, line] : cols) collinear(line, false);
+
+    // 横竖交叉：同一x上先插入横线，再查询竖线，最后删除横线
+    struct Event { int x, order, id; };
+    std::vector<Event> events;
+    for (auto& [y, line] : rows) {
+        for (int id : line) {
+            events.push_back({ all[id].x1, 0, id });
+            events.push_back({ all[id].x2, 2, id });
+        }
+    }
+    for (auto& [x, line] : cols) {
+        for (int id : line) events.push_back({ x, 1, id });
+    }
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        return a.x != b.x ? a.x < b.x : a.order < b.order;
+    });
+    std::multimap<int, int> active;
+    std::map<int, std::multimap<int, int>::iterator> where;
+    for (const Event& e : events) {
+        const Shape& s = all[e.id];
+        if (e.order == 0) where[e.id] = active.insert({ s.y1, e.id });
+        else if (e.order == 2) {
+            active.erase(where[e.id]);
+            where.erase(e.id);
+        }
+        else {
+            for (auto it = active.lower_bound(s.y1); it != active.end() && it->first <= s.y2; ++it) {
+                hits.push_back({ it->second, e.id, layer, e.x, it->first });
+            }
+        }
+    }
+    return hits;
+}
+
+inline Report check(const Layout& layout, int threads = 1) {
+    Report report;
+    report.off_grid = layout.off_grid;
+    const auto& shapes = layout.shapes;
+    int layers = layout.layers;
+    for (const Shape& s : shapes) layers = std::max(layers, s.layer + 1);
+
+    // 越界
+    for (const Shape& s : shapes) {
+        bool out = layout.layers > 0 && s.layer >= layout.layers;
+        if (layout.width > 0 && (s.x1 < layout.x0 || s.x2 >= layout.x0 + layout.width)) out = true;
+        if (layout.height > 0 && (s.y1 < layout.y0 || s.y2 >= layout.y0 + layout.height)) out = true;
+        if (!out) continue;
+        if (report.examples.size() < MAX_EXAMPLES) {
+            report.examples.push_back("越界：线网" + layout.nets[s.net] + "在层" + std::to_string(s.layer) + "的(" +
+                std::to_string(s.x1) + "," + std::to_string(s.y1) + ")-(" + std::to_string(s.x2) + "," + std::to_string(s.y2) + ")");
+        }
+        ++report.out_of_bounds;
+    }
+
+    // 过孔在每层都放一份
+    std::vector<std::vector<int>> per_layer(std::max(layers, 1));
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        if (shapes[i].kind == VIA) {
+            for (auto& ids : per_layer) ids.push_back(i);
+        }
+        else if (shapes[i].layer >= 0) per_layer[shapes[i].layer].push_back(i);
+    }
+    std::vector<std::vector<Hit>> layer_hits(per_layer.size());
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int l; (l = next++) < (int)per_layer.size(); ) layer_hits[l] = sweepLayer(shapes, per_layer[l], l);
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < std::min<int>(threads, per_layer.size()); ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
+
+    // 同一线网的并入并查集，不同线网的按(线网对, 位置)去重后计数
+    std::vector<int> parent(shapes.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&](int a) {
+        while (parent[a] != a) a = parent[a] = parent[parent[a]];
+        return a;
+    };
+    std::set<std::tuple<int, int, int, int, int>> seen;
+    for (const auto& hits : layer_hits) {
+        for (const Hit& h : hits) {
+            const Shape& a = shapes[h.a];
+            const Shape& b = shapes[h.b];
+            if (a.net == b.net) {
+                parent[find(h.a)] = find(h.b);
+                continue;
+            }
+            if ((a.kind == VIA) != (b.kind == VIA)) continue;
+            bool via = a.kind == VIA;
+            int layer = via ? -1 : h.layer;
+            if (!seen.insert({ std::min(a.net, b.net), std::max(a.net, b.net), layer, h.x, h.y }).second) continue;
+            if (via) ++report.via_conflicts;
+            else ++report.shorts;
+            if (report.examples.size() < MAX_EXAMPLES) {
+                std::string kind = via ? "过孔冲突" : a.kind == PIN || b.kind == PIN ? "引脚短路" : "短路";
+                report.examples.push_back(kind + "：线网" + layout.nets[a.net] + "与" +
+                    layout.nets[b.net] + (via ? "" : "在层" + std::to_string(h.layer)) + "的(" + std::to_string(h.x) + "," + std::to_string(h.y) + ")");
+            }
+        }
+    }
+
+    // 开路：线网的引脚不在同一连通分量
+    std::vector<int> first_pin(layout.nets.size(), -1);
+    std::vector<char> open(layout.nets.size(), 0);
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        if (shapes[i].kind != PIN) continue;
+        int net = shapes[i].net;
+        if (first_pin[net] < 0) first_pin[net] = i;
+        else if (!open[net] && find(first_pin[net]) != find(i)) {
+            open[net] = 1;
+            ++report.opens;
+            if (report.examples.size() < MAX_EXAMPLES) {
+                report.examples.push_back("开路：线网" + layout.nets[net] + "的引脚(" + std::to_string(shapes[i].x1) + "," +
+                    std::to_string(shapes[i].y1) + ")未连通");
+            }
+        }
+    }
+    return report;
+}
+
+// 坐标须为整数，否则四舍五入并记为不在格点上
+inline int gridCoord(const nlohmann::json& v, Layout& layout) {
+    double d = v.get<double>();
+    if (d != std::floor(d)) ++layout.off_grid;
+    return int(std::lround(d));
+}
+
+// 从Route_after.json的一个模块节点（不含子模块）读出布线，坐标保持绝对值
+inline Layout fromRouteJson(const nlohmann::json& node) {
+    Layout layout;
+    layout.name = node.value("module_name", "");
+    if (!node.contains("nets") || node["nets"].is_null()) return layout;
+    for (const auto& n : node["nets"]) {
+        int net = layout.addNet(n["name"].get<std::string>());
+        if (n.contains("pins")) {
+            for (const auto& p : n["pins"]) layout.addPin(net, p["layer"].get<int>(), gridCoord(p["x"], layout), gridCoord(p["y"], layout));
+        }
+        if (n.contains("segments")) {
+            for (const auto& s : n["segments"]) {
+                layout.addSegment(net, s["layer"].get<int>(), gridCoord(s["start"]["x"], layout), gridCoord(s["start"]["y"], layout),
+                    gridCoord(s["end"]["x"], layout), gridCoord(s["end"]["y"], layout));
+            }
+        }
+        if (n.contains("vias")) {
+            for (const auto& v : n["vias"]) layout.addVia(net, gridCoord(v["x"], layout), gridCoord(v["y"], layout));
+        }
+    }
+    return layout;
+}
+
+inline void printReport(const std::string& module_name, const Report& report, std::ostream& out = std::cout) {
+    out << "检查模块" << module_name << "：短路" << report.shorts << "处，开路" << report.opens << "条，不在格点"
+        << report.off_grid << "处，越界" << report.out_of_bounds << "处，过孔冲突" << report.via_conflicts << "处" << std::endl;
+    for (const auto& line : report.examples) out << "  " << line << std::endl;
+}
+
+} // namespace drc